@@ -0,0 +1,110 @@
+use anyhow::{Context as _, Result};
+use std::fs;
+use std::io::{BufRead, BufReader, Read, Seek, SeekFrom, Write};
+use std::net::{TcpListener, TcpStream};
+use std::path::Path;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::thread;
+use std::time::Duration;
+
+const MAX_CONNECTIONS: usize = 64;
+const IO_TIMEOUT: Duration = Duration::from_secs(30);
+
+pub fn cache_serve(addr: &str, blob_dir: &str) -> Result<()> {
+    let listener = TcpListener::bind(addr).with_context(|| format!("Failed to bind {}", addr))?;
+    println!("{}", serde_json::json!({ "success": true, "listening": listener.local_addr()?.to_string(), "root": blob_dir }));
+    let active = Arc::new(AtomicUsize::new(0));
+    for stream in listener.incoming() {
+        let mut stream = match stream {
+            Ok(s) => s,
+            Err(_) => continue,
+        };
+        if active.fetch_add(1, Ordering::SeqCst) >= MAX_CONNECTIONS {
+            active.fetch_sub(1, Ordering::SeqCst);
+            let _ = stream.write_all(b"HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            continue;
+        }
+        let active = Arc::clone(&active);
+        let root = blob_dir.to_string();
+        thread::spawn(move || {
+            let _ = stream.set_read_timeout(Some(IO_TIMEOUT));
+            let _ = stream.set_write_timeout(Some(IO_TIMEOUT));
+            let _ = handle(stream, &root);
+            active.fetch_sub(1, Ordering::SeqCst);
+        });
+    }
+    Ok(())
+}
+
+fn handle(stream: TcpStream, root: &str) -> Result<()> {
+    let mut reader = BufReader::new(stream.try_clone()?);
+    let mut request_line = String::new();
+    reader.read_line(&mut request_line)?;
+    let mut range_start: u64 = 0;
+    loop {
+        let mut line = String::new();
+        if reader.read_line(&mut line)? == 0 || line.trim().is_empty() {
+            break;
+        }
+        if let Some((name, value)) = line.split_once(':') {
+            if name.trim().eq_ignore_ascii_case("range") {
+                range_start = parse_range(value.trim()).unwrap_or(0);
+            }
+        }
+    }
+    let mut out = stream;
+    let parts: Vec<&str> = request_line.split_whitespace().collect();
+    if parts.len() < 2 || (parts[0] != "GET" && parts[0] != "HEAD") {
+        return respond_empty(&mut out, "405 Method Not Allowed");
+    }
+    let digest = match parts[1].strip_prefix("/sha256/") {
+        Some(d) if d.len() == 64 && d.bytes().all(|b| b.is_ascii_hexdigit()) => d.to_ascii_lowercase(),
+        _ => return respond_empty(&mut out, "404 Not Found"),
+    };
+    let path = Path::new(root).join(&digest);
+    let mut file = match fs::File::open(&path) {
+        Ok(f) => f,
+        Err(_) => return respond_empty(&mut out, "404 Not Found"),
+    };
+    let len = file.metadata()?.len();
+    if range_start > 0 && range_start >= len {
+        out.write_all(format!("HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */{}\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", len).as_bytes())?;
+        return Ok(());
+    }
+    let header = if range_start > 0 {
+        format!(
+            "HTTP/1.1 206 Partial Content\r\nContent-Type: application/octet-stream\r\nContent-Length: {}\r\nContent-Range: bytes {}-{}/{}\r\nAccept-Ranges: bytes\r\nConnection: close\r\n\r\n",
+            len - range_start,
+            range_start,
+            len.saturating_sub(1),
+            len
+        )
+    } else {
+        format!(
+            "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: {}\r\nAccept-Ranges: bytes\r\nConnection: close\r\n\r\n",
+            len
+        )
+    };
+    out.write_all(header.as_bytes())?;
+    if parts[0] == "GET" {
+        file.seek(SeekFrom::Start(range_start))?;
+        std::io::copy(&mut file.take(len - range_start), &mut out)?;
+    }
+    out.flush()?;
+    Ok(())
+}
+
+fn parse_range(value: &str) -> Option<u64> {
+    let spec = value.strip_prefix("bytes=")?;
+    let (start, end) = spec.split_once('-')?;
+    if !end.trim().is_empty() {
+        return None;
+    }
+    start.trim().parse().ok()
+}
+
+fn respond_empty(out: &mut TcpStream, status: &str) -> Result<()> {
+    out.write_all(format!("HTTP/1.1 {}\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status).as_bytes())?;
+    Ok(())
+}
@@ -0,0 +1,24 @@
+use anyhow::{Context as _, Result};
+use std::fs::File;
+use std::path::Path;
+use walkdir::WalkDir;
+
+pub fn sync_tree(root: &str) -> Result<()> {
+    for entry in WalkDir::new(root).contents_first(true) {
+        let entry = entry?;
+        if entry.file_type().is_symlink() {
+            continue;
+        }
+        File::open(entry.path())
+        .and_then(|f| f.sync_all())
+        .with_context(|| format!("fsync {} failed", entry.path().display()))?;
+    }
+    Ok(())
+}
+
+pub fn sync_parent(path: &str) -> Result<()> {
+    let parent = Path::new(path).parent().unwrap_or(Path::new("/"));
+    File::open(parent)
+    .and_then(|f| f.sync_all())
+    .with_context(|| format!("fsync {} failed", parent.display()))
+}
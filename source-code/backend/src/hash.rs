@@ -0,0 +1,65 @@
+use anyhow::{anyhow, Result};
+use sha2::{Digest, Sha256};
+use std::fs::File;
+use std::io::Read;
+use std::os::unix::io::AsRawFd;
+
+const MMAP_CHUNK: usize = 8 * 1024 * 1024;
+const READ_BUFFER: usize = 1024 * 1024;
+
+pub fn blake3_file(path: &str) -> Result<String> {
+    let mut hasher = blake3::Hasher::new();
+    hasher.update_mmap_rayon(path)?;
+    if let Ok(file) = File::open(path) {
+        unsafe {
+            libc::posix_fadvise(file.as_raw_fd(), 0, 0, libc::POSIX_FADV_DONTNEED);
+        }
+    }
+    Ok(hasher.finalize().to_hex().to_string())
+}
+
+pub fn hash_file(path: &str) -> Result<String> {
+    let mut file = File::open(path)?;
+    let fd = file.as_raw_fd();
+    let len = file.metadata()?.len() as usize;
+    let mut hasher = Sha256::new();
+    unsafe {
+        libc::posix_fadvise(fd, 0, 0, libc::POSIX_FADV_SEQUENTIAL);
+    }
+    if len > 0 {
+        let ptr = unsafe {
+            libc::mmap(std::ptr::null_mut(), len, libc::PROT_READ, libc::MAP_PRIVATE, fd, 0)
+        };
+        if ptr == libc::MAP_FAILED {
+            let mut buf = vec![0u8; READ_BUFFER];
+            loop {
+                let n = file.read(&mut buf)?;
+                if n == 0 {
+                    break;
+                }
+                hasher.update(&buf[..n]);
+            }
+        } else {
+            unsafe {
+                libc::madvise(ptr, len, libc::MADV_SEQUENTIAL);
+            }
+            let data = unsafe { std::slice::from_raw_parts(ptr as *const u8, len) };
+            let mut off = 0;
+            while off < len {
+                let end = (off + MMAP_CHUNK).min(len);
+                hasher.update(&data[off..end]);
+                unsafe {
+                    libc::madvise(ptr.add(off), end - off, libc::MADV_DONTNEED);
+                }
+                off = end;
+            }
+            if unsafe { libc::munmap(ptr, len) } != 0 {
+                return Err(anyhow!("munmap failed"));
+            }
+        }
+    }
+    unsafe {
+        libc::posix_fadvise(fd, 0, 0, libc::POSIX_FADV_DONTNEED);
+    }
+    Ok(hex::encode(hasher.finalize()))
+}
@@ -0,0 +1,287 @@
+use crate::root::rooted;
+use anyhow::{anyhow, Result};
+use std::cmp::Ordering;
+use std::collections::HashSet;
+use std::fs::{self, File};
+use std::os::unix::fs::FileExt;
+use std::path::Path;
+use walkdir::WalkDir;
+
+pub const LD_CACHE_FILE: &str = ".ld.so.cache";
+pub const HOST_LD_CACHE: &str = "/etc/ld.so.cache";
+const MAGIC: &[u8] = b"glibc-ld.so.cache1.1";
+const HEADER_LEN: usize = 48;
+const ENTRY_LEN: usize = 24;
+const EHDR_LEN: usize = 64;
+const MAX_PHDRS_LEN: usize = 64 * 1024;
+const MAX_DYNAMIC_LEN: usize = 64 * 1024;
+const MAX_SONAME_LEN: usize = 4096;
+const ET_DYN: u16 = 3;
+const PT_LOAD: u32 = 1;
+const PT_DYNAMIC: u32 = 2;
+const DT_NULL: u64 = 0;
+const DT_STRTAB: u64 = 5;
+const DT_SONAME: u64 = 14;
+
+struct Entry {
+    flags: i32,
+    key: String,
+    value: String,
+    hwcap: u64,
+}
+
+pub fn generate(pkg_dir: &Path) -> Result<usize> {
+    let host = fs::read(rooted(HOST_LD_CACHE))?;
+    let (endian, host_entries) = read_cache(&host)?;
+    let flags = default_flags(&host_entries).ok_or(anyhow!("Host loader cache is empty"))?;
+    let own = File::open("/proc/self/exe")?;
+    let machine = read_at(&own, 0, EHDR_LEN).as_deref().and_then(elf_machine).ok_or(anyhow!("Cannot read own ELF header"))?;
+    let mut entries = Vec::new();
+    let mut sonames = HashSet::new();
+    for e in WalkDir::new(pkg_dir).sort_by(|a, b| a.file_name().cmp(b.file_name())).into_iter().filter_map(|e| e.ok()) {
+        if !e.file_type().is_file() {
+            continue;
+        }
+        let file = match File::open(e.path()) {
+            Ok(f) => f,
+            Err(_) => continue,
+        };
+        let header = match read_at(&file, 0, EHDR_LEN) {
+            Some(h) => h,
+            None => continue,
+        };
+        if elf_machine(&header) != Some(machine) {
+            continue;
+        }
+        let soname = match elf_soname(&file, &header) {
+            Some(s) => s,
+            None => continue,
+        };
+        let rel = e.path().strip_prefix(pkg_dir)?.to_string_lossy().into_owned();
+        if sonames.insert(soname.clone()) {
+            entries.push(Entry { flags, key: soname, value: format!("/app/{}", rel), hwcap: 0 });
+        }
+    }
+    if entries.is_empty() {
+        let _ = fs::remove_file(pkg_dir.join(LD_CACHE_FILE));
+        return Ok(0);
+    }
+    let count = entries.len();
+    entries.extend(
+        host_entries
+        .into_iter()
+        .filter(|h| h.hwcap == 0 && !(h.flags == flags && sonames.contains(&h.key))),
+    );
+    entries.sort_by(|a, b| libcmp(b.key.as_bytes(), a.key.as_bytes()));
+    let tmp = pkg_dir.join(format!("{}.{}", LD_CACHE_FILE, std::process::id()));
+    fs::write(&tmp, write_cache(endian, &entries))?;
+    if let Err(e) = fs::rename(&tmp, pkg_dir.join(LD_CACHE_FILE)) {
+        let _ = fs::remove_file(&tmp);
+        return Err(e.into());
+    }
+    Ok(count)
+}
+
+pub fn is_current(cache: &Path) -> bool {
+    match (fs::metadata(cache).and_then(|m| m.modified()), fs::metadata(rooted(HOST_LD_CACHE)).and_then(|m| m.modified())) {
+        (Ok(own), Ok(host)) => own >= host,
+        _ => false,
+    }
+}
+
+fn read_at(f: &File, off: u64, len: usize) -> Option<Vec<u8>> {
+    let mut buf = vec![0u8; len];
+    f.read_exact_at(&mut buf, off).ok()?;
+    Some(buf)
+}
+
+fn read_some_at(f: &File, off: u64, len: usize) -> Option<Vec<u8>> {
+    let mut buf = vec![0u8; len];
+    let n = f.read_at(&mut buf, off).ok()?;
+    buf.truncate(n);
+    Some(buf)
+}
+
+fn u16_at(d: &[u8], off: usize) -> Option<u16> {
+    Some(u16::from_le_bytes(d.get(off..off + 2)?.try_into().ok()?))
+}
+
+fn u32_at(d: &[u8], off: usize) -> Option<u32> {
+    Some(u32::from_le_bytes(d.get(off..off + 4)?.try_into().ok()?))
+}
+
+fn u64_at(d: &[u8], off: usize) -> Option<u64> {
+    Some(u64::from_le_bytes(d.get(off..off + 8)?.try_into().ok()?))
+}
+
+fn cstr_at(d: &[u8], off: usize) -> Option<String> {
+    let rest = d.get(off..)?;
+    let end = rest.iter().position(|&b| b == 0)?;
+    Some(String::from_utf8_lossy(&rest[..end]).into_owned())
+}
+
+fn read_cache(d: &[u8]) -> Result<(u8, Vec<Entry>)> {
+    if !d.starts_with(MAGIC) || d.len() < HEADER_LEN {
+        return Err(anyhow!("Unsupported host loader cache format"));
+    }
+    let endian = d[28];
+    if endian == 3 || (endian == 0 && cfg!(target_endian = "big")) {
+        return Err(anyhow!("Unsupported host loader cache endianness"));
+    }
+    let nlibs = u32_at(d, 20).unwrap_or(0) as usize;
+    let mut entries = Vec::with_capacity(nlibs);
+    for i in 0..nlibs {
+        let off = HEADER_LEN + i * ENTRY_LEN;
+        let bad = || anyhow!("Truncated host loader cache");
+        let key = cstr_at(d, u32_at(d, off + 4).ok_or_else(bad)? as usize).ok_or_else(bad)?;
+        let value = cstr_at(d, u32_at(d, off + 8).ok_or_else(bad)? as usize).ok_or_else(bad)?;
+        entries.push(Entry {
+            flags: u32_at(d, off).ok_or_else(bad)? as i32,
+            key,
+            value,
+            hwcap: u64_at(d, off + 16).ok_or_else(bad)?,
+        });
+    }
+    Ok((endian, entries))
+}
+
+fn write_cache(endian: u8, entries: &[Entry]) -> Vec<u8> {
+    let strings_start = HEADER_LEN + entries.len() * ENTRY_LEN;
+    let mut strings: Vec<u8> = Vec::new();
+    let mut table = Vec::with_capacity(entries.len() * ENTRY_LEN);
+    for e in entries {
+        let key = (strings_start + strings.len()) as u32;
+        strings.extend_from_slice(e.key.as_bytes());
+        strings.push(0);
+        let value = (strings_start + strings.len()) as u32;
+        strings.extend_from_slice(e.value.as_bytes());
+        strings.push(0);
+        table.extend_from_slice(&e.flags.to_le_bytes());
+        table.extend_from_slice(&key.to_le_bytes());
+        table.extend_from_slice(&value.to_le_bytes());
+        table.extend_from_slice(&0u32.to_le_bytes());
+        table.extend_from_slice(&e.hwcap.to_le_bytes());
+    }
+    let mut out = Vec::with_capacity(strings_start + strings.len());
+    out.extend_from_slice(MAGIC);
+    out.extend_from_slice(&(entries.len() as u32).to_le_bytes());
+    out.extend_from_slice(&(strings.len() as u32).to_le_bytes());
+    out.push(endian);
+    out.extend_from_slice(&[0u8; 3]);
+    out.extend_from_slice(&[0u8; 16]);
+    out.extend_from_slice(&table);
+    out.extend_from_slice(&strings);
+    out
+}
+
+fn default_flags(entries: &[Entry]) -> Option<i32> {
+    if let Some(e) = entries.iter().find(|e| e.key == "libc.so.6" && e.hwcap == 0) {
+        return Some(e.flags);
+    }
+    let mut counts: Vec<(i32, usize)> = Vec::new();
+    for e in entries.iter().filter(|e| e.hwcap == 0) {
+        match counts.iter_mut().find(|(f, _)| *f == e.flags) {
+            Some((_, n)) => *n += 1,
+            None => counts.push((e.flags, 1)),
+        }
+    }
+    counts.into_iter().max_by_key(|(_, n)| *n).map(|(f, _)| f)
+}
+
+fn libcmp(a: &[u8], b: &[u8]) -> Ordering {
+    let (mut i, mut j) = (0, 0);
+    while i < a.len() {
+        if j >= b.len() {
+            return Ordering::Greater;
+        }
+        let (ca, cb) = (a[i], b[j]);
+        if ca.is_ascii_digit() {
+            if !cb.is_ascii_digit() {
+                return Ordering::Greater;
+            }
+            let (mut va, mut vb) = (0u64, 0u64);
+            while i < a.len() && a[i].is_ascii_digit() {
+                va = va * 10 + (a[i] - b'0') as u64;
+                i += 1;
+            }
+            while j < b.len() && b[j].is_ascii_digit() {
+                vb = vb * 10 + (b[j] - b'0') as u64;
+                j += 1;
+            }
+            if va != vb {
+                return va.cmp(&vb);
+            }
+        } else if cb.is_ascii_digit() {
+            return Ordering::Less;
+        } else if ca != cb {
+            return ca.cmp(&cb);
+        } else {
+            i += 1;
+            j += 1;
+        }
+    }
+    if j < b.len() { Ordering::Less } else { Ordering::Equal }
+}
+
+fn elf_machine(d: &[u8]) -> Option<(u8, u16)> {
+    if !d.starts_with(b"\x7fELF") || d.get(5) != Some(&1) {
+        return None;
+    }
+    Some((*d.get(4)?, u16_at(d, 18)?))
+}
+
+fn elf_soname(f: &File, h: &[u8]) -> Option<String> {
+    let is64 = h.get(4)? == &2;
+    if u16_at(h, 16)? != ET_DYN {
+        return None;
+    }
+    let (phoff, phentsize, phnum) = if is64 {
+        (u64_at(h, 32)?, u16_at(h, 54)? as usize, u16_at(h, 56)? as usize)
+    } else {
+        (u32_at(h, 28)? as u64, u16_at(h, 42)? as usize, u16_at(h, 44)? as usize)
+    };
+    if phentsize * phnum > MAX_PHDRS_LEN {
+        return None;
+    }
+    let d = read_at(f, phoff, phentsize * phnum)?;
+    let mut loads = Vec::new();
+    let mut dynamic = None;
+    for i in 0..phnum {
+        let ph = i * phentsize;
+        let (p_type, offset, vaddr, filesz) = if is64 {
+            (u32_at(&d, ph)?, u64_at(&d, ph + 8)?, u64_at(&d, ph + 16)?, u64_at(&d, ph + 32)?)
+        } else {
+            (u32_at(&d, ph)?, u32_at(&d, ph + 4)? as u64, u32_at(&d, ph + 8)? as u64, u32_at(&d, ph + 16)? as u64)
+        };
+        match p_type {
+            PT_LOAD => loads.push((offset, vaddr, filesz)),
+            PT_DYNAMIC => dynamic = Some((offset, (filesz as usize).min(MAX_DYNAMIC_LEN))),
+            _ => {}
+        }
+    }
+    let (dyn_off, dyn_size) = dynamic?;
+    let d = read_at(f, dyn_off, dyn_size)?;
+    let ent = if is64 { 16 } else { 8 };
+    let (mut strtab, mut soname) = (None, None);
+    for k in 0..dyn_size / ent {
+        let off = k * ent;
+        let (tag, val) = if is64 {
+            (u64_at(&d, off)?, u64_at(&d, off + 8)?)
+        } else {
+            (u32_at(&d, off)? as u64, u32_at(&d, off + 4)? as u64)
+        };
+        match tag {
+            DT_NULL => break,
+            DT_STRTAB => strtab = Some(val),
+            DT_SONAME => soname = Some(val),
+            _ => {}
+        }
+    }
+    let strtab = strtab?;
+    let file_off = loads
+    .iter()
+    .find(|(_, vaddr, filesz)| strtab >= *vaddr && strtab < vaddr + filesz)
+    .map(|(offset, vaddr, _)| strtab - vaddr + offset)?;
+    let name = read_some_at(f, file_off.checked_add(soname?)?, MAX_SONAME_LEN)?;
+    cstr_at(&name, 0).filter(|s| !s.is_empty() && !s.contains('/'))
+}
@@ -2,6 +2,7 @@ use anyhow::{Context as _, Result};
 use base64::{engine::general_purpose, Engine as _};
 use ed25519_dalek::{VerifyingKey, Signature, Verifier};
 use error::{output_error, ErrorCode};
+use nix::unistd::{access, AccessFlags};
 use std::env;
 use std::fs;
 use std::path::Path;
@@ -9,9 +10,22 @@ use std::process::exit;
 use verify::verify;
 use state::{load_state, save_state, update_state};
 use sandbox::setup_sandbox;
+use reaper::{move_to_trash, reap};
+use durability::{sync_parent, sync_tree};
+use cache_serve::cache_serve;
+use hash::{blake3_file, hash_file};
+use readahead::Readahead;
+use root::{rooted, set_root};
 
+mod cache_serve;
+mod durability;
+mod hash;
+mod ldcache;
 mod error;
 mod manifest;
+mod readahead;
+mod reaper;
+mod root;
 mod sandbox;
 mod state;
 mod verify;
@@ -19,7 +33,11 @@ mod verify;
 const PUBLIC_KEY_BYTES: [u8; 32] = [0u8; 32];
 
 fn main() {
-    let args: Vec<String> = env::args().skip(1).collect();
+    let mut args: Vec<String> = env::args().skip(1).collect();
+    if args.len() >= 2 && args[0] == "--root" {
+        set_root(&args[1]);
+        args.drain(..2);
+    }
     if args.is_empty() {
         output_error(ErrorCode::InvalidArgs, "Invalid arguments");
     }
@@ -27,9 +45,10 @@ fn main() {
     match command.as_str() {
         "install" => {
             if args.len() < 5 {
-                output_error(ErrorCode::InvalidArgs, "Usage: backend install <package> <version> <path> <checksum>");
+                output_error(ErrorCode::InvalidArgs, "Usage: backend install <package> <version> <path> <checksum> [none|commit|strict]");
             }
-            if let Err(e) = install(&args[1], &args[2], &args[3], &args[4]) {
+            let strict = args.get(5).map(|s| s == "strict").unwrap_or(false);
+            if let Err(e) = install(&args[1], &args[2], &args[3], &args[4], strict) {
                 output_error(ErrorCode::InstallFailed, &format!("Install failed: {}", e));
             }
         }
@@ -50,6 +69,20 @@ fn main() {
             }
             println!("{}", serde_json::json!({ "success": true }));
         }
+        "hash" => {
+            if args.len() < 2 {
+                output_error(ErrorCode::InvalidArgs, "Usage: backend hash <file> [sha256|blake3]");
+            }
+            let algo = args.get(2).map(|s| s.as_str()).unwrap_or("sha256");
+            if algo != "sha256" && algo != "blake3" {
+                output_error(ErrorCode::InvalidArgs, &format!("Unsupported digest algorithm: {}", algo));
+            }
+            let res = if algo == "blake3" { blake3_file(&args[1]) } else { hash_file(&args[1]) };
+            match res {
+                Ok(digest) => println!("{}", serde_json::json!({ "success": true, "algo": algo, "digest": digest })),
+                Err(e) => output_error(ErrorCode::VerificationFailed, &format!("Hash failed: {}", e)),
+            }
+        }
         "verify-signature" => {
             if args.len() < 3 {
                 output_error(ErrorCode::InvalidArgs, "Usage: backend verify-signature <path> <signature>");
@@ -59,6 +92,27 @@ fn main() {
             }
             println!("{}", serde_json::json!({ "success": true }));
         }
+        "reap" => {
+            if let Err(e) = reap() {
+                output_error(ErrorCode::RemoveFailed, &format!("Reap failed: {}", e));
+            }
+        }
+        "cache-serve" => {
+            if args.len() < 3 {
+                output_error(ErrorCode::InvalidArgs, "Usage: backend cache-serve <addr:port> <blob-dir>");
+            }
+            if let Err(e) = cache_serve(&args[1], &args[2]) {
+                output_error(ErrorCode::UnknownCommand, &format!("Cache serve failed: {}", e));
+            }
+        }
+        "specs" => {
+            if args.len() < 2 {
+                output_error(ErrorCode::InvalidArgs, "Usage: backend specs <path>");
+            }
+            if let Err(e) = specs(&args[1]) {
+                output_error(ErrorCode::InvalidArgs, &format!("Specs failed: {}", e));
+            }
+        }
         "list-installed" => {
             if let Err(e) = list_installed() {
                 output_error(ErrorCode::UnknownCommand, &format!("List installed failed: {}", e));
@@ -84,7 +138,7 @@ fn main() {
     }
 }
 
-fn install(package_name: &str, version: &str, path: &str, checksum: &str) -> Result<()> {
+fn install(package_name: &str, version: &str, path: &str, checksum: &str, strict: bool) -> Result<()> {
     let tmp_path = format!("{}.tmp", path);
     fs::create_dir_all(&tmp_path).context("Failed to create tmp directory")?;
     let contents_path = format!("{}/contents", &tmp_path);
@@ -99,7 +153,11 @@ fn install(package_name: &str, version: &str, path: &str, checksum: &str) -> Res
     }
     let manifest = manifest::Manifest::load_info(&tmp_path)?;
     verify(&tmp_path, checksum)?;
-    setup_sandbox(&tmp_path, &manifest, true, None, vec![], false).context("Sandbox setup failed")?;
+    setup_sandbox(&tmp_path, &manifest, true, None, vec![], false, Readahead::Off).context("Sandbox setup failed")?;
+    let _ = ldcache::generate(Path::new(&tmp_path));
+    if strict {
+        sync_tree(&tmp_path)?;
+    }
     let path_p = Path::new(path);
     let path_old = format!("{}.old", path);
     let mut backed_up = false;
@@ -109,6 +167,9 @@ fn install(package_name: &str, version: &str, path: &str, checksum: &str) -> Res
             backed_up = true;
         }
         fs::rename(&tmp_path, path).context("Rename failed")?;
+        if strict {
+            sync_parent(path)?;
+        }
         update_state(package_name, version, checksum)?;
         Ok(())
     })();
@@ -122,7 +183,7 @@ fn install(package_name: &str, version: &str, path: &str, checksum: &str) -> Res
         return Err(e);
     }
     if backed_up {
-        fs::remove_dir_all(&path_old).context("Remove backup failed")?;
+        move_to_trash(&path_old, &format!("{}-{}.old", package_name, version)).context("Remove backup failed")?;
     }
     println!("{}", serde_json::json!({ "success": true, "package_name": package_name }));
     Ok(())
@@ -131,9 +192,9 @@ fn install(package_name: &str, version: &str, path: &str, checksum: &str) -> Res
 fn remove(package_name: &str, version: &str, path: &str) -> Result<()> {
     let manifest = manifest::Manifest::load_info(path)?;
     for bin in &manifest.bins {
-        let _ = fs::remove_file(format!("/usr/bin/{}", bin));
+        let _ = fs::remove_file(rooted(&format!("/usr/bin/{}", bin)));
     }
-    fs::remove_dir_all(path).context("Delete tree failed")?;
+    move_to_trash(path, &format!("{}-{}", package_name, version)).context("Delete tree failed")?;
     let mut state = load_state()?;
     if let Some(vers) = state.packages.get_mut(package_name) {
         vers.remove(version);
@@ -153,6 +214,17 @@ fn verify_signature(path: &str, signature_base64: &str) -> Result<()> {
     Ok(())
 }
 
+fn specs(path: &str) -> Result<()> {
+    let manifest = manifest::Manifest::load_info(path)?;
+    let specs: serde_json::Map<String, serde_json::Value> = manifest
+    .system_specs
+    .iter()
+    .map(|(k, v)| (k.clone(), serde_json::Value::String(v.clone())))
+    .collect();
+    println!("{}", serde_json::json!({ "success": true, "package_name": manifest.name, "version": manifest.version, "specs": specs }));
+    Ok(())
+}
+
 fn list_installed() -> Result<()> {
     let state = load_state()?;
     println!("{}", serde_json::to_string(&state)?);
@@ -161,15 +233,36 @@ fn list_installed() -> Result<()> {
 
 fn sandbox_test(path: &str) -> Result<()> {
     let manifest = manifest::Manifest::load_info(path)?;
-    setup_sandbox(path, &manifest, false, None, vec![], true)
+    setup_sandbox(path, &manifest, false, None, vec![], true, Readahead::Off)
 }
 
 fn run(args: &[String]) -> Result<()> {
+    let record = args[0] == "--record-readahead";
+    let args = if record { &args[1..] } else { args };
+    if args.len() < 2 {
+        return Err(anyhow::anyhow!("Usage: backend run [--record-readahead] <package> <bin> [args...]"));
+    }
     let package_name = &args[0];
     let bin = &args[1];
     let extra_args = args[2..].to_vec();
-    let path = format!("{}{}/current", crate::sandbox::STORE_PATH, package_name);
+    let profile_path = rooted(&format!("{}pkgs/{}", crate::sandbox::PROFILE_PATH, package_name));
+    let path = match fs::read_link(&profile_path) {
+        Ok(target) if Path::new(&rooted(&target.to_string_lossy())).exists() => rooted(&target.to_string_lossy()),
+        _ => rooted(&format!("{}{}/current", crate::sandbox::STORE_PATH, package_name)),
+    };
     let manifest = manifest::Manifest::load_info(&path)?;
-    setup_sandbox(&path, &manifest, false, Some(bin), extra_args, false)?;
+    let pkg_dir = fs::canonicalize(&path).unwrap_or_else(|_| Path::new(&path).to_path_buf());
+    let ld_cache = pkg_dir.join(ldcache::LD_CACHE_FILE);
+    if ld_cache.exists() && !ldcache::is_current(&ld_cache) && access(&pkg_dir, AccessFlags::W_OK).is_ok() {
+        let _ = ldcache::generate(&pkg_dir);
+    }
+    let readahead = if record {
+        Readahead::Record(&pkg_dir)
+    } else if readahead::profile_path(&pkg_dir).exists() {
+        Readahead::Replay(&pkg_dir)
+    } else {
+        Readahead::Off
+    };
+    setup_sandbox(&path, &manifest, false, Some(bin), extra_args, false, readahead)?;
     Ok(())
 }
@@ -0,0 +1,183 @@
+use crate::root::rooted;
+use crate::sandbox::RO_PATHS;
+use anyhow::{anyhow, Result};
+use nix::unistd::Pid;
+use std::collections::HashSet;
+use std::fs::{self, File};
+use std::os::unix::fs::MetadataExt;
+use std::os::unix::io::AsRawFd;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant};
+
+pub const READAHEAD_FILE: &str = ".readahead";
+const RECORD_WINDOW: Duration = Duration::from_secs(30);
+const FAST_PHASE: Duration = Duration::from_secs(2);
+const FAST_INTERVAL: Duration = Duration::from_millis(5);
+const SLOW_INTERVAL: Duration = Duration::from_millis(50);
+const MAX_FILES: usize = 4096;
+const MAX_FILE_BYTES: u64 = 64 * 1024 * 1024;
+const MAX_THREADS: usize = 8;
+const BATCH: usize = 16;
+
+pub enum Readahead<'a> {
+    Off,
+    Replay(&'a Path),
+    Record(&'a Path),
+}
+
+pub fn profile_path(pkg_dir: &Path) -> PathBuf {
+    pkg_dir.join(READAHEAD_FILE)
+}
+
+pub struct Recorder {
+    stop: Arc<AtomicBool>,
+    handle: JoinHandle<Vec<String>>,
+}
+
+pub fn start_recording(child: Pid) -> Recorder {
+    let stop = Arc::new(AtomicBool::new(false));
+    let flag = Arc::clone(&stop);
+    let own_exe = fs::metadata("/proc/self/exe").map(|m| (m.dev(), m.ino())).ok();
+    let handle = thread::spawn(move || {
+        let mut seen = HashSet::new();
+        let mut order = Vec::new();
+        let started = Instant::now();
+        while !flag.load(Ordering::Relaxed) && started.elapsed() < RECORD_WINDOW && order.len() < MAX_FILES {
+            for pid in process_tree(child.as_raw()) {
+                let exe = fs::metadata(format!("/proc/{}/exe", pid)).map(|m| (m.dev(), m.ino())).ok();
+                if exe.is_none() || exe == own_exe {
+                    continue;
+                }
+                sample(pid, &mut seen, &mut order);
+            }
+            thread::sleep(if started.elapsed() < FAST_PHASE { FAST_INTERVAL } else { SLOW_INTERVAL });
+        }
+        order
+    });
+    Recorder { stop, handle }
+}
+
+impl Recorder {
+    pub fn finish(self, pkg_dir: &Path) -> Result<usize> {
+        self.stop.store(true, Ordering::Relaxed);
+        let order = self.handle.join().map_err(|_| anyhow!("Recorder thread panicked"))?;
+        if order.is_empty() {
+            return Ok(0);
+        }
+        let tmp = pkg_dir.join(format!("{}.{}", READAHEAD_FILE, std::process::id()));
+        let mut data = order.join("\n");
+        data.push('\n');
+        fs::write(&tmp, data)?;
+        if let Err(e) = fs::rename(&tmp, profile_path(pkg_dir)) {
+            let _ = fs::remove_file(&tmp);
+            return Err(e.into());
+        }
+        Ok(order.len())
+    }
+}
+
+fn process_tree(root: i32) -> Vec<i32> {
+    let mut pids = vec![root];
+    let mut i = 0;
+    while i < pids.len() {
+        let pid = pids[i];
+        if let Ok(tasks) = fs::read_dir(format!("/proc/{}/task", pid)) {
+            for task in tasks.filter_map(|t| t.ok()) {
+                if let Ok(children) = fs::read_to_string(task.path().join("children")) {
+                    pids.extend(children.split_whitespace().filter_map(|c| c.parse::<i32>().ok()));
+                }
+            }
+        }
+        i += 1;
+    }
+    pids
+}
+
+fn sample(pid: i32, seen: &mut HashSet<String>, order: &mut Vec<String>) {
+    let mut found: Vec<String> = Vec::new();
+    if let Ok(maps) = fs::read_to_string(format!("/proc/{}/maps", pid)) {
+        found.extend(maps.lines().filter_map(map_path).map(str::to_string));
+    }
+    if let Ok(fds) = fs::read_dir(format!("/proc/{}/fd", pid)) {
+        for fd in fds.filter_map(|f| f.ok()) {
+            if let Ok(target) = fs::read_link(fd.path()) {
+                if let Some(t) = target.to_str() {
+                    found.push(t.to_string());
+                }
+            }
+        }
+    }
+    for p in found {
+        if wanted(&p) && seen.insert(p.clone()) {
+            order.push(p);
+        }
+    }
+}
+
+fn map_path(line: &str) -> Option<&str> {
+    let mut rest = line;
+    for _ in 0..5 {
+        rest = rest.trim_start();
+        rest = &rest[rest.find(' ')?..];
+    }
+    let p = rest.trim();
+    if p.starts_with('/') && !p.ends_with(" (deleted)") { Some(p) } else { None }
+}
+
+fn wanted(p: &str) -> bool {
+    if let Some(rel) = p.strip_prefix("/app/") {
+        return !rel.starts_with(READAHEAD_FILE);
+    }
+    RO_PATHS.iter().any(|r| p.strip_prefix(r).map_or(false, |rest| rest.starts_with('/')))
+}
+
+fn resolve(pkg_dir: &Path, p: &str) -> Option<PathBuf> {
+    match p.strip_prefix("/app/") {
+        Some(rel) => Some(pkg_dir.join(rel)),
+        None if p.starts_with('/') => Some(PathBuf::from(rooted(p))),
+        None => None,
+    }
+}
+
+pub fn replay(pkg_dir: &Path) {
+    let data = match fs::read_to_string(profile_path(pkg_dir)) {
+        Ok(d) => d,
+        Err(_) => return,
+    };
+    let files: Arc<Vec<PathBuf>> = Arc::new(data.lines().filter_map(|l| resolve(pkg_dir, l.trim())).collect());
+    if files.is_empty() {
+        return;
+    }
+    let cursor = Arc::new(AtomicUsize::new(0));
+    let threads = thread::available_parallelism().map_or(2, |n| n.get()).min(MAX_THREADS);
+    for _ in 0..threads.min((files.len() + BATCH - 1) / BATCH) {
+        let files = Arc::clone(&files);
+        let cursor = Arc::clone(&cursor);
+        thread::spawn(move || loop {
+            let start = cursor.fetch_add(BATCH, Ordering::Relaxed);
+            if start >= files.len() {
+                break;
+            }
+            for path in &files[start..(start + BATCH).min(files.len())] {
+                prefetch_file(path);
+            }
+        });
+    }
+}
+
+fn prefetch_file(path: &Path) {
+    let file = match File::open(path) {
+        Ok(f) => f,
+        Err(_) => return,
+    };
+    let len = match file.metadata() {
+        Ok(m) if m.is_file() => m.len().min(MAX_FILE_BYTES),
+        _ => return,
+    };
+    unsafe {
+        libc::readahead(file.as_raw_fd(), 0, len as usize);
+    }
+}
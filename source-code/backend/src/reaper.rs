@@ -0,0 +1,68 @@
+use anyhow::{Context as _, Result};
+use std::fs;
+use std::os::unix::io::AsRawFd;
+use std::path::PathBuf;
+use std::thread;
+use std::time::{SystemTime, UNIX_EPOCH};
+
+use crate::root::rooted;
+use crate::sandbox::TRASH_PATH;
+
+const REAPER_THREADS: usize = 4;
+const IOPRIO_WHO_PROCESS: libc::c_int = 1;
+const IOPRIO_CLASS_IDLE: libc::c_int = 3;
+const IOPRIO_CLASS_SHIFT: libc::c_int = 13;
+
+pub fn move_to_trash(path: &str, label: &str) -> Result<()> {
+    let trash = rooted(TRASH_PATH);
+    fs::create_dir_all(&trash).context("Failed to create trash directory")?;
+    let nanos = SystemTime::now()
+    .duration_since(UNIX_EPOCH)
+    .map(|d| d.as_nanos())
+    .unwrap_or(0);
+    let dest = format!("{}{}-{}-{}", trash, label, std::process::id(), nanos);
+    fs::rename(path, &dest).context("Move to trash failed")?;
+    Ok(())
+}
+
+pub fn reap() -> Result<()> {
+    let trash = rooted(TRASH_PATH);
+    let dir = match fs::File::open(&trash) {
+        Ok(d) => d,
+        Err(_) => return Ok(()),
+    };
+    if unsafe { libc::flock(dir.as_raw_fd(), libc::LOCK_EX | libc::LOCK_NB) } != 0 {
+        return Ok(());
+    }
+    lower_priority();
+    let entries: Vec<PathBuf> = fs::read_dir(&trash)?
+    .filter_map(|e| e.ok())
+    .map(|e| e.path())
+    .collect();
+    let handles: Vec<_> = (0..REAPER_THREADS)
+    .map(|i| entries.iter().skip(i).step_by(REAPER_THREADS).cloned().collect::<Vec<_>>())
+    .filter(|chunk| !chunk.is_empty())
+    .map(|chunk| {
+        thread::spawn(move || {
+            for p in chunk {
+                let is_dir = fs::symlink_metadata(&p).map(|m| m.is_dir()).unwrap_or(false);
+                let res = if is_dir { fs::remove_dir_all(&p) } else { fs::remove_file(&p) };
+                if let Err(e) = res {
+                    eprintln!("reap: {}: {}", p.display(), e);
+                }
+            }
+        })
+    })
+    .collect();
+    for h in handles {
+        let _ = h.join();
+    }
+    Ok(())
+}
+
+fn lower_priority() {
+    unsafe {
+        libc::setpriority(libc::PRIO_PROCESS, 0, 19);
+        libc::syscall(libc::SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+    }
+}
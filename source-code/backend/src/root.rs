@@ -0,0 +1,14 @@
+use std::sync::OnceLock;
+
+static ROOT: OnceLock<String> = OnceLock::new();
+
+pub fn set_root(root: &str) {
+    let _ = ROOT.set(root.trim_end_matches('/').to_string());
+}
+
+pub fn rooted(path: &str) -> String {
+    match ROOT.get() {
+        Some(root) => format!("{}{}", root, path),
+        None => path.to_string(),
+    }
+}
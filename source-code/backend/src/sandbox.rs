@@ -1,4 +1,7 @@
+use crate::ldcache::{is_current, LD_CACHE_FILE, HOST_LD_CACHE};
 use crate::manifest::{Manifest, Sandbox};
+use crate::readahead::{replay, start_recording, Readahead};
+use crate::root::rooted;
 use anyhow::{anyhow, Context as _, Result};
 use landlock::{
     Access, AccessFs, PathBeneath, PathFd, Ruleset, RulesetAttr, RulesetCreatedAttr, ABI,
@@ -21,6 +24,9 @@ use std::process::exit;
 use nix::sys::wait::{waitpid, WaitPidFlag, WaitStatus};
 
 pub const STORE_PATH: &str = "/usr/lib/HackerOS/hpm/store/";
+pub const PROFILE_PATH: &str = "/usr/lib/HackerOS/hpm/profile/";
+pub const TRASH_PATH: &str = "/usr/lib/HackerOS/hpm/store/.trash/";
+pub const RO_PATHS: [&str; 5] = ["/usr", "/lib", "/lib64", "/bin", "/etc"];
 
 pub fn setup_sandbox(
     path: &str,
@@ -29,12 +35,27 @@ pub fn setup_sandbox(
     bin: Option<&str>,
     extra_args: Vec<String>,
     test: bool,
+    readahead: Readahead,
 ) -> Result<()> {
     let (read_fd, write_fd) = pipe().context("Pipe creation failed")?;
     match unsafe { fork()? } {
         ForkResult::Parent { child, .. } => {
             drop(write_fd);
+            let recorder = match readahead {
+                Readahead::Replay(dir) => {
+                    replay(dir);
+                    None
+                }
+                Readahead::Record(dir) => Some((dir, start_recording(child))),
+                Readahead::Off => None,
+            };
             let status = waitpid(child, Some(WaitPidFlag::empty()))?;
+            if let Some((dir, rec)) = recorder {
+                match rec.finish(dir) {
+                    Ok(n) => eprintln!("Readahead profile: {} files", n),
+                    Err(e) => eprintln!("Readahead profile not saved: {}", e),
+                }
+            }
             let code = if let WaitStatus::Exited(_, c) = status { c } else { 1 };
             if code != 0 {
                 let mut buf = vec![0u8; 1024];
@@ -118,13 +139,13 @@ fn setup_user_mapping() -> Result<()> {
 }
 
 fn setup_mounts(new_root: &Path, path: &str, sandbox: &Sandbox, display: Option<&String>) -> Result<()> {
-    let ro_paths = vec!["/usr", "/lib", "/lib64", "/bin", "/etc"];
-    for p in ro_paths {
+    for p in RO_PATHS {
         let target = new_root.join(p.trim_start_matches('/'));
-        if Path::new(p).exists() {
+        let source = rooted(p);
+        if Path::new(&source).exists() {
             create_dir_all(&target)?;
             mount(
-                Some(p),
+                Some(source.as_str()),
                   target.to_str().unwrap(),
                   None::<&str>,
                   MsFlags::MS_BIND | MsFlags::MS_REC | MsFlags::MS_RDONLY,
@@ -132,6 +153,17 @@ fn setup_mounts(new_root: &Path, path: &str, sandbox: &Sandbox, display: Option<
             )?;
         }
     }
+    let ld_cache = Path::new(path).join(LD_CACHE_FILE);
+    let ld_target = new_root.join(HOST_LD_CACHE.trim_start_matches('/'));
+    if is_current(&ld_cache) && ld_target.exists() {
+        mount(
+            Some(&ld_cache),
+              &ld_target,
+              None::<&str>,
+              MsFlags::MS_BIND,
+              None::<&str>,
+        )?;
+    }
     let app_path = new_root.join("app");
     create_dir_all(&app_path)?;
     mount(
@@ -225,7 +257,7 @@ fn setup_landlock(manifest: &Manifest) -> Result<()> {
     .handle_access(AccessFs::from_all(abi))?
     .create()?;
     let ro_access = AccessFs::Execute | AccessFs::ReadFile | AccessFs::ReadDir;
-    for path in &["/usr", "/lib", "/lib64", "/bin", "/etc"] {
+    for path in &RO_PATHS {
         if Path::new(path).exists() {
             ruleset = ruleset.add_rule(PathBeneath::new(PathFd::new(path)?, ro_access))?;
         }
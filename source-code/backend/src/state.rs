@@ -3,6 +3,7 @@ use serde::{Deserialize, Serialize};
 use std::collections::HashMap;
 use std::fs;
 use std::path::Path;
+use crate::root::rooted;
 
 const STATE_PATH: &str = "/var/lib/hpm/state.json";
 
@@ -12,18 +13,20 @@ pub struct State {
 }
 
 pub fn load_state() -> Result<State> {
-    if !Path::new(STATE_PATH).exists() {
+    let path = rooted(STATE_PATH);
+    if !Path::new(&path).exists() {
         return Ok(State::default());
     }
-    let data = fs::read(STATE_PATH)?;
+    let data = fs::read(&path)?;
     serde_json::from_slice(&data).map_err(Into::into)
 }
 
 pub fn save_state(state: &State) -> Result<()> {
     let data = serde_json::to_vec(state)?;
-    let tmp_path = format!("{}.tmp", STATE_PATH);
+    let path = rooted(STATE_PATH);
+    let tmp_path = format!("{}.tmp", path);
     fs::write(&tmp_path, data)?;
-    fs::rename(&tmp_path, STATE_PATH)?;
+    fs::rename(&tmp_path, &path)?;
     Ok(())
 }
 
@@ -2,24 +2,40 @@ use anyhow::{anyhow, Result};
 use sha2::{Digest, Sha256};
 use std::fs;
 use std::path::Path;
+use crate::ldcache::LD_CACHE_FILE;
+use crate::readahead::READAHEAD_FILE;
 use walkdir::WalkDir;
 
 pub fn verify(path: &str, checksum: &str) -> Result<()> {
-    let computed = compute_dir_hash(Path::new(path))?;
-    if computed != checksum {
-        return Err(anyhow!("Checksum mismatch: computed {}, expected {}", computed, checksum));
+    let (computed, expected) = match checksum.split_once(':') {
+        Some(("blake3", hex)) => (compute_dir_hash_blake3(Path::new(path))?, hex),
+        Some((algo, _)) => return Err(anyhow!("Unsupported digest algorithm: {}", algo)),
+        None => (compute_dir_hash(Path::new(path))?, checksum),
+    };
+    if computed != expected {
+        return Err(anyhow!("Checksum mismatch: computed {}, expected {}", computed, expected));
     }
     Ok(())
 }
 
-pub fn compute_dir_hash(dir: &Path) -> Result<String> {
-    let entries: Vec<_> = WalkDir::new(dir)
+fn tree_files(dir: &Path) -> Vec<std::path::PathBuf> {
+    WalkDir::new(dir)
     .sort_by(|a, b| a.file_name().cmp(b.file_name()))
     .into_iter()
     .filter_map(|e| e.ok())
     .filter(|e| e.file_type().is_file())
+    .filter(|e| !is_generated(e))
     .map(|e| e.path().to_owned())
-    .collect();
+    .collect()
+}
+
+fn is_generated(e: &walkdir::DirEntry) -> bool {
+    e.depth() == 1
+    && e.file_name().to_str().map_or(false, |n| n.starts_with(READAHEAD_FILE) || n.starts_with(LD_CACHE_FILE))
+}
+
+pub fn compute_dir_hash(dir: &Path) -> Result<String> {
+    let entries = tree_files(dir);
     let mut hasher = Sha256::new();
     for file_path in entries {
         let data = fs::read(&file_path)?;
@@ -28,3 +44,12 @@ pub fn compute_dir_hash(dir: &Path) -> Result<String> {
     let hash = hasher.finalize();
     Ok(hex::encode(hash))
 }
+
+pub fn compute_dir_hash_blake3(dir: &Path) -> Result<String> {
+    let mut hasher = blake3::Hasher::new();
+    for file_path in tree_files(dir) {
+        let data = fs::read(&file_path)?;
+        hasher.update_rayon(&data);
+    }
+    Ok(hasher.finalize().to_hex().to_string())
+}
@@ -0,0 +1,171 @@
+package hpm
+
+import "base:intrinsics"
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strconv"
+import "core:time"
+import "core:sys/linux"
+
+BENCH_DEFAULT_FILES :: 2000
+BENCH_DEFAULT_SIZE  :: 16 * 1024
+BENCH_HASH_DEFAULT_MIB :: 512
+
+// hpm bench <co> — mikrobenchmarki ścieżek krytycznych na tym systemie
+bench :: proc(allocator: mem.Allocator, args: []string) -> Error {
+    if len(args) == 0 {
+        return .InvalidArgs
+    }
+    switch args[0] {
+        case "durability":
+            return bench_durability(allocator, args[1:])
+        case "hash":
+            return bench_hash(allocator, args[1:])
+    }
+    return .InvalidArgs
+}
+
+// Symuluje rozpakowanie paczki (N plików po S bajtów w katalogu .tmp,
+// potem rename) i mierzy koszt każdego trybu --durability.
+bench_durability :: proc(allocator: mem.Allocator, args: []string) -> Error {
+    files := BENCH_DEFAULT_FILES
+    size := BENCH_DEFAULT_SIZE
+    for i := 0; i < len(args); i += 1 {
+        if i + 1 >= len(args) {
+            return .InvalidArgs
+        }
+        n, ok := strconv.parse_int(args[i+1])
+        if !ok || n < 1 {
+            return .InvalidArgs
+        }
+        switch args[i] {
+            case "--files":
+                files = n
+            case "--size":
+                size = n
+            case:
+                return .InvalidArgs
+        }
+        i += 1
+    }
+    payload := make([]u8, size, allocator)
+    defer delete(payload)
+    for i in 0..<size {
+        payload[i] = u8(i * 31)
+    }
+
+    fmt.printf("%sDurability benchmark:%s %d files x %s in %s\n", COLOR_BLUE, COLOR_RESET, files, format_bytes(i64(size)), STORE_PATH)
+    modes := [?]Durability{.None, .Commit, .Strict}
+    for mode in modes {
+        dir := fmt.tprintf("%s.bench-%s", STORE_PATH, durability_name(mode))
+        tmp_dir := fmt.tprintf("%s.tmp", dir)
+        remove_tree(dir)
+        remove_tree(tmp_dir)
+        // Zaczynamy od czystego stanu, żeby poprzedni tryb nie zostawił brudnych stron
+        sync_filesystem(STORE_PATH)
+        if !makedirs(tmp_dir) {
+            return .BackendFailed
+        }
+        start := time.now()
+        for i in 0..<files {
+            path := fmt.tprintf("%s/f%d", tmp_dir, i)
+            if !os.write_entire_file(path, payload) {
+                remove_tree(tmp_dir)
+                return .BackendFailed
+            }
+            if mode == .Strict {
+                fsync_path(path)
+            }
+        }
+        if mode == .Strict {
+            fsync_path(tmp_dir)
+        }
+        if mode != .None {
+            sync_filesystem(STORE_PATH)
+        }
+        os.rename(tmp_dir, dir)
+        if mode != .None {
+            fsync_path(STORE_PATH)
+        }
+        elapsed := time.diff(start, time.now())
+        ms := time.duration_milliseconds(elapsed)
+        fmt.printf("  %s%-7s%s %10.1f ms  %8.1f µs/file\n", COLOR_CYAN, durability_name(mode), COLOR_RESET, ms, ms * 1000 / f64(files))
+        remove_tree(dir)
+    }
+    return .None
+}
+
+// Przepustowość sha256 dla archiwum w cache: dawna ścieżka (4 KiB read),
+// duże bufory w procesie i backend, a dla porównania BLAKE3 na wszystkich
+// rdzeniach. Każdy przebieg startuje z zimnego cache.
+bench_hash :: proc(allocator: mem.Allocator, args: []string) -> Error {
+    mib := BENCH_HASH_DEFAULT_MIB
+    if len(args) == 2 && args[0] == "--size" {
+        n, ok := strconv.parse_int(args[1])
+        if !ok || n < 1 {
+            return .InvalidArgs
+        }
+        mib = n
+    } else if len(args) != 0 {
+        return .InvalidArgs
+    }
+    if !makedirs(CACHE_PATH) {
+        return .CacheFailed
+    }
+    path := fmt.tprintf("%s.bench-hash", CACHE_PATH)
+    defer os.remove(path)
+    f, err := os.open(path, os.O_WRONLY | os.O_CREATE | os.O_TRUNC, 0o644)
+    if err != os.ERROR_NONE {
+        return .CacheFailed
+    }
+    block := make([]u8, 1024 * 1024, allocator)
+    defer delete(block)
+    for i in 0..<mib {
+        for j in 0..<len(block) {
+            block[j] = u8((i * 7 + j * 31) >> 3)
+        }
+        if n, werr := os.write(f, block); werr != os.ERROR_NONE || n != len(block) {
+            os.close(f)
+            return .CacheFailed
+        }
+    }
+    fsync_path(path)
+    os.close(f)
+
+    fmt.printf("%sSHA-256 benchmark:%s %d MiB in %s\n", COLOR_BLUE, COLOR_RESET, mib, path)
+    Method :: enum {Read4K, Read1M, Backend, Blake3}
+    names := [Method]string{.Read4K = "read 4K", .Read1M = "read 1M", .Backend = "backend", .Blake3 = "blake3"}
+    reference := ""
+    for method in Method {
+        // Zimny start: strony pliku poza page cache
+        if fd, oerr := os.open(path, os.O_RDONLY, 0); oerr == os.ERROR_NONE {
+            intrinsics.syscall(linux.SYS_fadvise64, uintptr(fd), 0, 0, POSIX_FADV_DONTNEED)
+            os.close(fd)
+        }
+        start := time.now()
+        sha: string
+        ok := true
+        switch method {
+            case .Read4K:
+                sha, _ = compute_sha256_portable(allocator, path, 4096)
+            case .Read1M:
+                sha, _ = compute_sha256_portable(allocator, path, HASH_READ_BUFFER)
+            case .Backend:
+                sha, ok = backend_hash(allocator, path)
+            case .Blake3:
+                sha, ok = backend_hash(allocator, path, DIGEST_BLAKE3)
+        }
+        elapsed := time.duration_seconds(time.diff(start, time.now()))
+        if !ok {
+            fmt.printf("  %s%-8s%s unavailable\n", COLOR_CYAN, names[method], COLOR_RESET)
+            continue
+        }
+        if reference == "" {
+            reference = sha
+        }
+        match := method == .Blake3 || sha == reference ? "" : "  (digest mismatch!)"
+        fmt.printf("  %s%-8s%s %8.1f ms  %8.1f MiB/s%s\n", COLOR_CYAN, names[method], COLOR_RESET, elapsed * 1000, f64(mib) / max(elapsed, 1e-9), match)
+    }
+    return .None
+}
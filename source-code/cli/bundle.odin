@@ -0,0 +1,269 @@
+package hpm
+
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:crypto/sha2"
+import "core:encoding/json"
+
+// Format paczki offline (seekowalny, bez kompresji na zewnątrz):
+//   "HPMBNDL1"           8 bajtów magii
+//   u64 LE               długość indeksu JSON
+//   indeks JSON          BundleIndex: przycięte repo + offsety archiwów
+//   archiwa .hpm         sklejone jedno za drugim (offsety liczone od końca indeksu)
+BUNDLE_MAGIC :: "HPMBNDL1"
+BUNDLE_HEADER_SIZE :: 16
+BUNDLE_COPY_CHUNK :: 1024 * 1024
+
+BundleEntry :: struct {
+    offset: i64,
+    size:   i64,
+    sha256: string,
+}
+
+BundleIndex :: struct {
+    repo:    Repo,
+    entries: map[string]BundleEntry,
+}
+
+Bundle :: struct {
+    path:        string,
+    fd:          os.Handle,
+    data_offset: i64,
+    index:       BundleIndex,
+}
+
+bundle_entry_name :: proc(pkg: string, version: string) -> string {
+    return fmt.tprintf("%s-%s.hpm", pkg, version)
+}
+
+put_u64le :: proc(buf: []u8, v: u64) {
+    for i in 0..<8 {
+        buf[i] = u8(v >> (8 * u64(i)))
+    }
+}
+
+get_u64le :: proc(buf: []u8) -> u64 {
+    v: u64 = 0
+    for i in 0..<8 {
+        v |= u64(buf[i]) << (8 * u64(i))
+    }
+    return v
+}
+
+open_bundle :: proc(allocator: mem.Allocator, path: string) -> (Bundle, Error) {
+    fd, err := os.open(path, os.O_RDONLY, 0)
+    if err != os.ERROR_NONE {
+        return {}, .BundleFailed
+    }
+    header: [BUNDLE_HEADER_SIZE]u8
+    n, rerr := os.read(fd, header[:])
+    if rerr != os.ERROR_NONE || n != BUNDLE_HEADER_SIZE || string(header[:8]) != BUNDLE_MAGIC {
+        os.close(fd)
+        log_to_file("ERROR", fmt.tprintf("%s is not an hpm bundle", path))
+        return {}, .BundleFailed
+    }
+    index_len := int(get_u64le(header[8:]))
+    index_data := make([]u8, index_len, allocator)
+    defer delete(index_data)
+    n, rerr = os.read_at(fd, index_data, BUNDLE_HEADER_SIZE)
+    if rerr != os.ERROR_NONE || n != index_len {
+        os.close(fd)
+        return {}, .BundleFailed
+    }
+    b := Bundle{path = path, fd = fd, data_offset = i64(BUNDLE_HEADER_SIZE + index_len)}
+    if json.unmarshal(index_data, &b.index, allocator = allocator) != nil {
+        os.close(fd)
+        return {}, .BundleFailed
+    }
+    return b, .None
+}
+
+close_bundle :: proc(b: ^Bundle, allocator: mem.Allocator) {
+    os.close(b.fd)
+    deinit_repo(&b.index.repo, allocator)
+    delete(b.index.entries)
+}
+
+// Rozpakowuje archiwum prosto z paczki do katalogu, licząc SHA256 w locie.
+// Nic nie jest kopiowane do CACHE_PATH.
+extract_from_bundle :: proc(b: ^Bundle, pkg: string, version: string, dest: string) -> Error {
+    entry, ok := b.index.entries[bundle_entry_name(pkg, version)]
+    if !ok {
+        log_to_file("ERROR", fmt.tprintf("%s@%s is not in bundle %s", pkg, version, b.path))
+        return .PackageNotFound
+    }
+    ctx: sha2.Context_256
+    sha2.init_256(&ctx)
+    unpack_args := []string{"tar", "-I", "zstd", "-xf", "-", "-C", dest}
+    code, run_err := run_command_stdin(unpack_args[:], b.fd, b.data_offset + entry.offset, entry.size, &ctx)
+    if code != 0 || run_err != .None {
+        return .UnpackFailed
+    }
+    hash: [sha2.DIGEST_SIZE_256]u8
+    sha2.final(&ctx, hash[:])
+    if hex_digest(hash[:]) != entry.sha256 {
+        log_to_file("ERROR", fmt.tprintf("SHA256 mismatch for %s@%s in bundle", pkg, version))
+        return .ChecksumMismatch
+    }
+    return .None
+}
+
+hex_digest :: proc(hash: []u8) -> string {
+    sb: strings.Builder
+    strings.builder_init(&sb, context.temp_allocator)
+    for b in hash {
+        fmt.sbprintf(&sb, "%02x", b)
+    }
+    return strings.to_string(sb)
+}
+
+// hpm bundle <pkg>[@ver]... -o <plik>
+make_bundle :: proc(allocator: mem.Allocator, args: []string) -> Error {
+    output := ""
+    specs: [dynamic]string
+    defer delete(specs)
+    for i := 0; i < len(args); i += 1 {
+        if args[i] == "-o" && i + 1 < len(args) {
+            output = args[i+1]
+            i += 1
+        } else {
+            append(&specs, args[i])
+        }
+    }
+    if output == "" || len(specs) == 0 {
+        return .InvalidArgs
+    }
+    // Pełny indeks: paczka może trafić na maszynę o innej architekturze
+    repo, repo_err := load_repo(allocator, false, true)
+    if repo_err != .None {
+        return repo_err
+    }
+    defer deinit_repo(&repo, allocator)
+
+    // Domknięcia wszystkich żądanych pakietów, bez duplikatów
+    items: [dynamic]PkgVer
+    defer delete(items)
+    seen := make(map[string]bool, allocator)
+    defer delete(seen)
+    for spec in specs {
+        parts := strings.split(spec, "@")
+        req := len(parts) > 1 ? fmt.tprintf("=%s", parts[1]) : ""
+        chosen: map[string]string
+        order: [dynamic]struct {pkg: string, ver: string}
+        res_err := resolve_deps_iterative(allocator, &repo, parts[0], req, &chosen, &order)
+        if res_err != .None {
+            return res_err
+        }
+        for item in order {
+            key := fmt.aprintf("%s@%s", item.pkg, item.ver)
+            if seen[key] {
+                continue
+            }
+            seen[key] = true
+            append(&items, PkgVer{item.pkg, item.ver})
+        }
+    }
+
+    jobs := make([]FetchJob, len(items), allocator)
+    defer delete(jobs)
+    for item, i in items {
+        ver_obj, _ := find_version(repo[item.pkg], item.ver)
+        jobs[i] = FetchJob{pkg = item.pkg, version = item.ver, url = ver_obj.url, sha256 = archive_digest(ver_obj), size = ver_obj.size}
+    }
+    fetch_err := prefetch_archives(jobs)
+    if fetch_err != .None {
+        return fetch_err
+    }
+
+    // Przycięty indeks: tylko wybrane pakiety i tylko wybrane wersje
+    index := BundleIndex{
+        repo    = make(Repo, allocator),
+        entries = make(map[string]BundleEntry, allocator),
+    }
+    offset: i64 = 0
+    for item in items {
+        src := repo[item.pkg]
+        pruned, has := index.repo[item.pkg]
+        if !has {
+            pruned = RepoPackage{author = src.author, license = src.license, description = src.description}
+        }
+        ver_obj, _ := find_version(src, item.ver)
+        append(&pruned.versions, ver_obj)
+        index.repo[item.pkg] = pruned
+
+        archive := cache_archive_path(item.pkg, item.ver)
+        st, serr := os.stat(archive, allocator)
+        if serr != os.ERROR_NONE {
+            return .BundleFailed
+        }
+        sha, sha_err := compute_sha256_stream(allocator, archive)
+        if sha_err != .None {
+            return sha_err
+        }
+        index.entries[strings.clone(bundle_entry_name(item.pkg, item.ver), allocator)] = BundleEntry{offset, st.size, sha}
+        offset += st.size
+    }
+    index_data, merr := json.marshal(index, allocator = allocator)
+    if merr != nil {
+        return .BundleFailed
+    }
+    defer delete(index_data)
+
+    tmp_output := fmt.tprintf("%s.tmp", output)
+    out, oerr := os.open(tmp_output, os.O_WRONLY | os.O_CREATE | os.O_TRUNC, 0o644)
+    if oerr != os.ERROR_NONE {
+        return .BundleFailed
+    }
+    header: [BUNDLE_HEADER_SIZE]u8
+    copy(header[:8], BUNDLE_MAGIC)
+    put_u64le(header[8:], u64(len(index_data)))
+    ok := write_all(out, header[:]) && write_all(out, index_data)
+    buf := make([]u8, BUNDLE_COPY_CHUNK, allocator)
+    defer delete(buf)
+    for item in items {
+        if !ok {
+            break
+        }
+        in_fd, ierr := os.open(cache_archive_path(item.pkg, item.ver), os.O_RDONLY, 0)
+        if ierr != os.ERROR_NONE {
+            ok = false
+            break
+        }
+        for {
+            n, rerr := os.read(in_fd, buf)
+            if rerr != os.ERROR_NONE {
+                ok = false
+                break
+            }
+            if n == 0 {
+                break
+            }
+            if !write_all(out, buf[:n]) {
+                ok = false
+                break
+            }
+        }
+        os.close(in_fd)
+    }
+    os.close(out)
+    if !ok || os.rename(tmp_output, output) != os.ERROR_NONE {
+        os.remove(tmp_output)
+        return .BundleFailed
+    }
+    fmt.printf("%s✔ Bundle %s written: %d package(s), %s.%s\n", COLOR_GREEN, output, len(items), format_bytes(offset), COLOR_RESET)
+    return .None
+}
+
+write_all :: proc(fd: os.Handle, data: []u8) -> bool {
+    written := 0
+    for written < len(data) {
+        n, err := os.write(fd, data[written:])
+        if err != os.ERROR_NONE || n <= 0 {
+            return false
+        }
+        written += n
+    }
+    return true
+}
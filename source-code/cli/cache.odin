@@ -0,0 +1,445 @@
+package hpm
+
+import "base:intrinsics"
+import "base:runtime"
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:time"
+import "core:sort"
+import "core:encoding/json"
+import "core:sync"
+import "core:sys/linux"
+
+// Indeks cache: rozmiar, ostatni dostęp i przypięcie każdego archiwum,
+// żeby `cache stats` i eksmisja LRU nie musiały skanować katalogu.
+CACHE_INDEX_PATH :: "/var/cache/hpm/index.json"
+CACHE_INDEX_TMP  :: "/var/cache/hpm/index.json.tmp"
+
+CacheEntry :: struct {
+    pkg:         string,
+    version:     string,
+    size:        i64,
+    last_access: time.Time,
+    pinned:      bool,
+    // Pamięć weryfikacji: skrót sprawdzony dla pliku o tej tożsamości.
+    // Dopóki (ino, size, mtime, ctime) się zgadzają, archiwum nie jest haszowane ponownie.
+    digest:      string,
+    ino:         u64,
+    mtime_ns:    i64,
+    ctime_ns:    i64,
+    // Korzenie (--root, "/" dla hosta), w których ta wersja jest w stanie.
+    // Cache jest wspólny, więc eksmisja patrzy na wszystkie, nie tylko na bieżący.
+    roots:       [dynamic]string,
+}
+
+// --paranoid: zawsze pełna weryfikacja archiwów z cache, z pominięciem pamięci skrótów
+paranoid: bool
+
+// fetch_archive chodzi w kilku wątkach naraz; chroni pamięć skrótów transakcji
+cache_index_mutex: sync.Mutex
+
+// Cache pobrań jest wspólny dla wszystkich korzeni (--root), a każdy korzeń ma
+// własną blokadę LOCK_PATH, więc kilka procesów hpm może go używać naraz.
+// index.lock (flock LOCK_EX) obejmuje każdy load-modify-save indeksu.
+// use.lock trzymają współdzielnie transakcje od acquire_lock aż do
+// cache_after_transaction; eksmisja i clean biorą go na wyłączność bez czekania
+// i odpuszczają, gdy inny proces może właśnie rozpakowywać archiwa.
+CACHE_INDEX_LOCK :: "/var/cache/hpm/index.lock"
+CACHE_USE_LOCK   :: "/var/cache/hpm/use.lock"
+LOCK_SH :: 1
+LOCK_EX :: 2
+LOCK_NB :: 4
+
+cache_use_fd: linux.Fd = -1
+
+flock_path :: proc(path: string, op: int) -> (linux.Fd, bool) {
+    fd, err := linux.open(strings.clone_to_cstring(path, context.temp_allocator), {.RDWR, .CREAT, .CLOEXEC}, {.IRUSR, .IWUSR, .IRGRP, .IROTH})
+    if err != .NONE {
+        return -1, false
+    }
+    if int(intrinsics.syscall(linux.SYS_flock, uintptr(fd), uintptr(op))) < 0 {
+        linux.close(fd)
+        return -1, false
+    }
+    return fd, true
+}
+
+cache_use_begin :: proc() {
+    if cache_use_fd < 0 {
+        cache_use_fd, _ = flock_path(CACHE_USE_LOCK, LOCK_SH)
+    }
+}
+
+cache_use_end :: proc() {
+    if cache_use_fd >= 0 {
+        linux.close(cache_use_fd)
+        cache_use_fd = -1
+    }
+}
+
+cache_index_lock :: proc() -> linux.Fd {
+    fd, _ := flock_path(CACHE_INDEX_LOCK, LOCK_EX)
+    return fd
+}
+
+cache_index_unlock :: proc(fd: linux.Fd) {
+    if fd >= 0 {
+        linux.close(fd)
+    }
+}
+
+CacheIndex :: struct {
+    total_bytes: i64,
+    entries:     map[string]CacheEntry,
+}
+
+load_cache_index :: proc(allocator: mem.Allocator) -> CacheIndex {
+    data, ok := os.read_entire_file(CACHE_INDEX_PATH, allocator)
+    if !ok {
+        return rebuild_cache_index(allocator)
+    }
+    defer delete(data)
+    index: CacheIndex
+    if json.unmarshal(data, &index, allocator = allocator) != nil {
+        return rebuild_cache_index(allocator)
+    }
+    if index.entries == nil {
+        index.entries = make(map[string]CacheEntry, allocator)
+    }
+    return index
+}
+
+save_cache_index :: proc(index: ^CacheIndex, allocator: mem.Allocator) -> Error {
+    data, merr := json.marshal(index^, allocator = allocator)
+    if merr != nil {
+        return .CacheFailed
+    }
+    defer delete(data)
+    if !os.write_entire_file(CACHE_INDEX_TMP, data) {
+        return .CacheFailed
+    }
+    if os.rename(CACHE_INDEX_TMP, CACHE_INDEX_PATH) != os.ERROR_NONE {
+        return .CacheFailed
+    }
+    return .None
+}
+
+// Odtwarza indeks ze stanu katalogu (brak indeksu albo uszkodzony plik)
+rebuild_cache_index :: proc(allocator: mem.Allocator) -> CacheIndex {
+    index := CacheIndex{entries = make(map[string]CacheEntry, allocator)}
+    dir, err := os.open(CACHE_PATH)
+    if err != os.ERROR_NONE {
+        return index
+    }
+    defer os.close(dir)
+    files, _ := os.read_dir(dir, -1, allocator)
+    defer delete(files)
+    for file in files {
+        if !strings.has_suffix(file.name, ".hpm") {
+            continue
+        }
+        // Nazwa to <pkg>-<ver>.hpm; nazwy pakietów bywają z myślnikiem,
+        // więc dzielimy po ostatnim (wersje z '-' trafią tu źle, ale tylko do odbudowy)
+        base := strings.trim_suffix(file.name, ".hpm")
+        dash := strings.last_index(base, "-")
+        if dash <= 0 {
+            continue
+        }
+        index.entries[strings.clone(file.name, allocator)] = CacheEntry{
+            pkg         = strings.clone(base[:dash], allocator),
+            version     = strings.clone(base[dash+1:], allocator),
+            size        = file.size,
+            last_access = file.modification_time,
+        }
+        index.total_bytes += file.size
+    }
+    return index
+}
+
+// Zapisuje użycie archiwów, odświeża przypięcia i przycina cache do limitu.
+// Wywoływane przez install/update pod globalną blokadą.
+cache_after_transaction :: proc(allocator: mem.Allocator, state: ^StatePackages, used: []PkgVer) {
+    // Archiwa tej transakcji są już rozpakowane
+    cache_use_end()
+    cfg := load_config(allocator)
+    index_fd := cache_index_lock()
+    defer cache_index_unlock(index_fd)
+    index := load_cache_index(allocator)
+    defer cache_memo_reset()
+    cache_memo_apply(&index)
+    now := time.now()
+    for item in used {
+        name := fmt.aprintf("%s-%s.hpm", item.pkg, item.ver)
+        st, err := os.stat(cache_archive_path(item.pkg, item.ver), allocator)
+        if err != os.ERROR_NONE {
+            continue
+        }
+        entry := CacheEntry{pkg = item.pkg, version = item.ver}
+        if old, ok := index.entries[name]; ok {
+            index.total_bytes -= old.size
+            entry = old
+        }
+        entry.size = st.size
+        entry.last_access = now
+        index.entries[name] = entry
+        index.total_bytes += st.size
+    }
+    if use_fd, ok := flock_path(CACHE_USE_LOCK, LOCK_EX | LOCK_NB); ok {
+        evicted, freed := cache_enforce(allocator, &index, state, cfg.cache_max_bytes)
+        if evicted > 0 {
+            log_to_file("INFO", fmt.tprintf("cache: evicted %d archive(s), %d bytes", evicted, freed))
+            sweep_cache_blobs(allocator)
+        }
+        linux.close(use_fd)
+    } else {
+        log_to_file("INFO", "cache: in use by another hpm process, eviction deferred")
+    }
+    if save_cache_index(&index, allocator) != .None {
+        log_to_file("WARN", "cache: failed to save index")
+    }
+}
+
+archive_identity :: proc(path: string) -> (ino: u64, size: i64, mtime_ns: i64, ctime_ns: i64, ok: bool) {
+    st: linux.Stat
+    if linux.stat(strings.clone_to_cstring(path, context.temp_allocator), &st) != .NONE {
+        return
+    }
+    ino = u64(st.ino)
+    size = i64(st.size)
+    mtime_ns = i64(st.mtime.time_sec) * 1_000_000_000 + i64(st.mtime.time_nsec)
+    ctime_ns = i64(st.ctime.time_sec) * 1_000_000_000 + i64(st.ctime.time_nsec)
+    ok = true
+    return
+}
+
+// Pamięć skrótów w obrębie jednego procesu: indeks czytany raz, przy pierwszym
+// archiwum, a nowe skróty zbierane w pamięci i zapisywane jednym load-merge-save
+// (cache_after_transaction albo cache_memo_flush na końcu polecenia).
+// Sterta, nie arena main: przy setkach archiwów indeks jest spory.
+cache_memo_arena:   mem.Dynamic_Arena
+cache_memo_index:   CacheIndex
+cache_memo_loaded:  bool
+cache_memo_pending: map[string]CacheEntry
+
+// Wołane pod cache_index_mutex
+cache_memo_load :: proc() -> mem.Allocator {
+    if !cache_memo_loaded {
+        mem.dynamic_arena_init(&cache_memo_arena, runtime.heap_allocator(), runtime.heap_allocator())
+        memo_allocator := mem.dynamic_arena_allocator(&cache_memo_arena)
+        cache_memo_index = load_cache_index(memo_allocator)
+        cache_memo_pending = make(map[string]CacheEntry, memo_allocator)
+        cache_memo_loaded = true
+    }
+    return mem.dynamic_arena_allocator(&cache_memo_arena)
+}
+
+// Czy archiwum było już zweryfikowane na expected i od tamtej pory się nie zmieniło.
+// ctime łapie też zmiany, które zachowują mtime (touch -d, podmiana przez rename).
+cache_memo_matches :: proc(allocator: mem.Allocator, package_name: string, version: string, expected: string) -> bool {
+    if paranoid || expected == "" {
+        return false
+    }
+    ino, size, mtime_ns, ctime_ns, ok := archive_identity(cache_archive_path(package_name, version))
+    if !ok {
+        return false
+    }
+    sync.mutex_lock(&cache_index_mutex)
+    defer sync.mutex_unlock(&cache_index_mutex)
+    cache_memo_load()
+    entry, found := cache_memo_index.entries[fmt.tprintf("%s-%s.hpm", package_name, version)]
+    return found && entry.digest == expected && entry.ino == ino && entry.size == size && entry.mtime_ns == mtime_ns && entry.ctime_ns == ctime_ns
+}
+
+// Zapamiętuje skrót po udanej weryfikacji. Wołane po link_cache_blob, bo nowe
+// dowiązanie zmienia ctime. Stąd też indeks, a nie xattr: zapis xattr sam zmienia ctime.
+// Na dysk trafia dopiero w cache_memo_apply.
+cache_memo_record :: proc(allocator: mem.Allocator, package_name: string, version: string, digest: string) {
+    ino, size, mtime_ns, ctime_ns, ok := archive_identity(cache_archive_path(package_name, version))
+    if !ok {
+        return
+    }
+    sync.mutex_lock(&cache_index_mutex)
+    defer sync.mutex_unlock(&cache_index_mutex)
+    memo_allocator := cache_memo_load()
+    name := fmt.aprintf("%s-%s.hpm", package_name, version, allocator = memo_allocator)
+    entry := CacheEntry{pkg = strings.clone(package_name, memo_allocator), version = strings.clone(version, memo_allocator), last_access = time.now()}
+    if old, found := cache_memo_index.entries[name]; found {
+        entry = old
+    }
+    entry.size = size
+    entry.digest = strings.clone(digest, memo_allocator)
+    entry.ino = ino
+    entry.mtime_ns = mtime_ns
+    entry.ctime_ns = ctime_ns
+    cache_memo_index.entries[name] = entry
+    cache_memo_pending[name] = entry
+}
+
+// Przenosi zebrane skróty do świeżo wczytanego indeksu (pod index.lock).
+// Łączy tylko pola pamięci skrótów, więc nie nadpisuje zmian innych procesów.
+// Wpisy wskazują do areny pamięci skrótów — indeks trzeba zapisać przed cache_memo_reset.
+cache_memo_apply :: proc(index: ^CacheIndex) -> bool {
+    sync.mutex_lock(&cache_index_mutex)
+    defer sync.mutex_unlock(&cache_index_mutex)
+    if !cache_memo_loaded || len(cache_memo_pending) == 0 {
+        return false
+    }
+    for name, memo in cache_memo_pending {
+        entry := memo
+        if old, found := index.entries[name]; found {
+            index.total_bytes -= old.size
+            entry = old
+            entry.size = memo.size
+            entry.digest = memo.digest
+            entry.ino = memo.ino
+            entry.mtime_ns = memo.mtime_ns
+            entry.ctime_ns = memo.ctime_ns
+        }
+        index.entries[name] = entry
+        index.total_bytes += entry.size
+    }
+    return true
+}
+
+cache_memo_reset :: proc() {
+    sync.mutex_lock(&cache_index_mutex)
+    defer sync.mutex_unlock(&cache_index_mutex)
+    if cache_memo_loaded {
+        mem.dynamic_arena_destroy(&cache_memo_arena)
+        cache_memo_index = {}
+        cache_memo_pending = nil
+        cache_memo_loaded = false
+    }
+}
+
+// Zapis skrótów z poleceń bez cache_after_transaction (prefetch, bundle, błędy)
+cache_memo_flush :: proc(allocator: mem.Allocator) {
+    defer cache_memo_reset()
+    if !cache_memo_loaded {
+        return
+    }
+    index_fd := cache_index_lock()
+    defer cache_index_unlock(index_fd)
+    index := load_cache_index(allocator)
+    if cache_memo_apply(&index) && save_cache_index(&index, allocator) != .None {
+        log_to_file("WARN", "cache: failed to record verified digests")
+    }
+}
+
+CacheCandidate :: struct {
+    name:        string,
+    last_access: time.Time,
+}
+
+// Eksmisja LRU do max_bytes. Archiwa wersji zainstalowanych lub przypiętych
+// w którymkolwiek korzeniu nigdy nie są usuwane — to one są potrzebne przy rollbacku.
+// Bieżący korzeń odświeża swoje wpisy w roots; korzenie, których już nie ma, są z nich usuwane.
+cache_enforce :: proc(allocator: mem.Allocator, index: ^CacheIndex, state: ^StatePackages, max_bytes: i64) -> (int, i64) {
+    candidates: [dynamic]CacheCandidate
+    defer delete(candidates)
+    this_root := install_root != "" ? install_root : "/"
+    root_alive := make(map[string]bool, context.temp_allocator)
+    for name, entry in index.entries {
+        e := entry
+        vers, installed := state^[e.pkg]
+        vinfo, has_version := vers[e.version]
+        here := installed && has_version
+        kept := 0
+        for r in e.roots {
+            if r == this_root {
+                continue
+            }
+            alive, checked := root_alive[r]
+            if !checked {
+                alive = os.exists(r)
+                root_alive[r] = alive
+            }
+            if alive {
+                e.roots[kept] = r
+                kept += 1
+            }
+        }
+        resize(&e.roots, kept)
+        if here {
+            if e.roots == nil {
+                e.roots = make([dynamic]string, allocator)
+            }
+            append(&e.roots, strings.clone(this_root, allocator))
+            e.pinned = vinfo.pinned
+        } else if kept == 0 {
+            e.pinned = false
+        }
+        index.entries[name] = e
+        if len(e.roots) > 0 {
+            continue
+        }
+        append(&candidates, CacheCandidate{name, e.last_access})
+    }
+    if index.total_bytes <= max_bytes {
+        return 0, 0
+    }
+    sort.sort(sort.Interface{
+        collection = &candidates,
+        len = proc(it: sort.Interface) -> int { return len((^[dynamic]CacheCandidate)(it.collection)^) },
+              less = proc(it: sort.Interface, i, j: int) -> bool {
+                  arr := (^[dynamic]CacheCandidate)(it.collection)^
+                  return time.diff(arr[i].last_access, arr[j].last_access) > 0
+              },
+              swap = proc(it: sort.Interface, i, j: int) {
+                  arr := (^[dynamic]CacheCandidate)(it.collection)^
+                  arr[i], arr[j] = arr[j], arr[i]
+              },
+    })
+    evicted := 0
+    freed: i64 = 0
+    for c in candidates {
+        if index.total_bytes <= max_bytes {
+            break
+        }
+        entry := index.entries[c.name]
+        path := fmt.tprintf("%s%s", CACHE_PATH, c.name)
+        if os.exists(path) && os.remove(path) != os.ERROR_NONE {
+            continue
+        }
+        index.total_bytes -= entry.size
+        freed += entry.size
+        evicted += 1
+        delete_key(&index.entries, c.name)
+    }
+    return evicted, freed
+}
+
+cache_command :: proc(allocator: mem.Allocator, args: []string) -> Error {
+    sub := len(args) > 0 ? args[0] : "stats"
+    switch sub {
+        case "stats":
+            cfg := load_config(allocator)
+            index := load_cache_index(allocator)
+            pinned := 0
+            for _, entry in index.entries {
+                if entry.pinned { pinned += 1 }
+            }
+            fmt.printf("%sCache:%s %s\n", COLOR_BLUE, COLOR_RESET, CACHE_PATH)
+            fmt.printf("%sArchives:%s %d (%d pinned)\n", COLOR_BLUE, COLOR_RESET, len(index.entries), pinned)
+            fmt.printf("%sSize:%s %s / %s\n", COLOR_BLUE, COLOR_RESET, format_bytes(index.total_bytes), format_bytes(cfg.cache_max_bytes))
+            return .None
+        case "trim":
+            lock_err := acquire_lock()
+            if lock_err != .None {
+                return lock_err
+            }
+            defer release_lock()
+            state, state_err := load_state(allocator)
+            if state_err != .None {
+                return state_err
+            }
+            defer delete_state(&state, allocator)
+            cache_after_transaction(allocator, &state, {})
+            fmt.printf("%s✔ Cache trimmed.%s\n", COLOR_GREEN, COLOR_RESET)
+            return .None
+        case:
+            return .InvalidArgs
+    }
+}
@@ -0,0 +1,142 @@
+package hpm
+
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:sys/linux"
+
+// Archiwa w cache są dodatkowo dowiązane (hardlink) pod swoim sha256 w
+// CACHE_BLOB_DIR. `hpm cache-serve` udostępnia ten katalog innym hostom przez
+// HTTP (GET /sha256/<hex>), a install najpierw pyta peerów z config.peers,
+// dopiero potem origin. Weryfikacja sha256 jest ta sama co dla originu.
+CACHE_BLOB_DIR :: "/var/cache/hpm/by-sha256/"
+DEFAULT_CACHE_SERVE_ADDR :: "0.0.0.0:8765"
+
+cache_blob_path :: proc(sha: string) -> string {
+    return fmt.tprintf("%s%s", CACHE_BLOB_DIR, sha)
+}
+
+// Dowiązanie pod sha256; ten sam inode, więc nie kosztuje miejsca
+link_cache_blob :: proc(archive: string, sha: string) {
+    blob := cache_blob_path(sha)
+    if os.exists(blob) || !makedirs(CACHE_BLOB_DIR) {
+        return
+    }
+    linux.link(strings.clone_to_cstring(archive, context.temp_allocator), strings.clone_to_cstring(blob, context.temp_allocator))
+}
+
+// Dowiązania, których archiwum wyleciało z cache (nlink == 1), też usuwamy
+sweep_cache_blobs :: proc(allocator: mem.Allocator) {
+    dir, err := os.open(CACHE_BLOB_DIR)
+    if err != os.ERROR_NONE {
+        return
+    }
+    defer os.close(dir)
+    files, _ := os.read_dir(dir, -1, allocator)
+    defer delete(files)
+    for file in files {
+        st: linux.Stat
+        if linux.stat(strings.clone_to_cstring(file.fullpath, context.temp_allocator), &st) == .NONE && st.nlink <= 1 {
+            os.remove(file.fullpath)
+        }
+    }
+}
+
+// Próbuje pobrać archiwum o danym sha256 od peerów; true tylko po weryfikacji
+fetch_from_peers :: proc(allocator: mem.Allocator, sha: string, dest: string, quiet: bool) -> bool {
+    if sha == "" || len(config.peers) == 0 {
+        return false
+    }
+    part := fmt.tprintf("%s.peer.%d", dest, linux.getpid())
+    for peer in config.peers {
+        url := fmt.tprintf("%s/sha256/%s", strings.trim_right(peer, "/"), sha)
+        // Peer w tej samej sieci albo odpowiada od razu, albo go pomijamy
+        args: [dynamic]string
+        append(&args, "curl", "-sS", "--fail", "--connect-timeout", "1", "--speed-limit", "1024", "--speed-time", "10")
+        if download_rate_limit != "" {
+            append(&args, "--limit-rate", download_rate_limit)
+        }
+        append(&args, "-o", part, url)
+        code, err := run_command(args[:])
+        delete(args)
+        if code != 0 || err != .None {
+            os.remove(part)
+            continue
+        }
+        got, sha_err := compute_sha256_stream(allocator, part)
+        if sha_err != .None || got != sha {
+            log_to_file("WARN", fmt.tprintf("cache peer %s served a corrupt archive for %s", peer, sha))
+            os.remove(part)
+            continue
+        }
+        if os.rename(part, dest) != os.ERROR_NONE {
+            os.remove(part)
+            return false
+        }
+        if !quiet {
+            fmt.printf("%s✔ Fetched from cache peer %s.%s\n", COLOR_GREEN, peer, COLOR_RESET)
+        }
+        log_to_file("INFO", fmt.tprintf("cache peer hit: %s from %s", sha, peer))
+        return true
+    }
+    return false
+}
+
+// hpm cache-serve [--listen addr:port] [--blob-dir dir] — serwuje katalog blobów
+// tylko do odczytu. Domyślnie CACHE_BLOB_DIR; z --blob-dir kilka instancji na
+// jednym hoście może serwować osobne katalogi pod osobnymi adresami.
+cache_serve :: proc(allocator: mem.Allocator, args: []string) -> Error {
+    addr := DEFAULT_CACHE_SERVE_ADDR
+    blob_dir := CACHE_BLOB_DIR
+    for i := 0; i < len(args); i += 1 {
+        if args[i] == "--listen" && i + 1 < len(args) {
+            addr = args[i + 1]
+            i += 1
+        } else if strings.has_prefix(args[i], "--listen=") {
+            addr = strings.trim_prefix(args[i], "--listen=")
+        } else if args[i] == "--blob-dir" && i + 1 < len(args) {
+            blob_dir = args[i + 1]
+            i += 1
+        } else if strings.has_prefix(args[i], "--blob-dir=") {
+            blob_dir = strings.trim_prefix(args[i], "--blob-dir=")
+        } else {
+            return .InvalidArgs
+        }
+    }
+    if !makedirs(blob_dir) {
+        return .CacheFailed
+    }
+    fmt.printf("%sServing %s on %s%s\n", COLOR_BLUE, blob_dir, addr, COLOR_RESET)
+    if blob_dir == CACHE_BLOB_DIR {
+        link_cached_archives(allocator)
+    }
+    code, err := run_command({BACKEND_PATH, "cache-serve", addr, blob_dir})
+    if err != .None {
+        return err
+    }
+    if code != 0 {
+        return .BackendFailed
+    }
+    return .None
+}
+
+// Archiwa pobrane przed włączeniem peerów nie mają jeszcze dowiązań
+link_cached_archives :: proc(allocator: mem.Allocator) {
+    index := load_cache_index(allocator)
+    linked := 0
+    for name in index.entries {
+        archive := fmt.tprintf("%s%s", CACHE_PATH, name)
+        st: linux.Stat
+        if linux.stat(strings.clone_to_cstring(archive, context.temp_allocator), &st) != .NONE || st.nlink > 1 {
+            continue
+        }
+        if sha, err := compute_sha256_stream(allocator, archive); err == .None {
+            link_cache_blob(archive, sha)
+            linked += 1
+        }
+    }
+    if linked > 0 {
+        log_to_file("INFO", fmt.tprintf("cache-serve: linked %d archive(s) by sha256", linked))
+    }
+}
@@ -0,0 +1,165 @@
+package hpm
+
+import "base:runtime"
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:sort"
+
+// Domknięcia zależności dla domyślnej instalacji (najnowsza wersja, bez
+// ograniczeń), wyliczane przy refresh tym samym solverem co install.
+// Plik czytany punktowo przez read_at — wyszukiwanie binarne po rekordach,
+// bez wczytywania całości:
+//   "HPMCLO01", u32 n, u32 blob, [64]u8 sha256 repo.json
+//   n x {u32 name_off, u32 name_len, u32 clo_off, u32 clo_len, u32 size_lo, u32 size_hi}
+//   blob: nazwy i domknięcia jako "pkg@ver pkg@ver ..." w kolejności instalacji
+CLOSURE_INDEX_PATH := "/usr/lib/HackerOS/hpm/closures.idx"
+CLOSURE_INDEX_TMP  := "/usr/lib/HackerOS/hpm/closures.idx.tmp"
+CLOSURE_INDEX_MAGIC :: "HPMCLO01"
+CLOSURE_HEADER_SIZE :: 8 + 4 * 2 + 64
+CLOSURE_RECORD_SIZE :: 24
+
+build_closure_index :: proc(repo_sha: string) -> bool {
+    arena: mem.Dynamic_Arena
+    mem.dynamic_arena_init(&arena, runtime.heap_allocator(), runtime.heap_allocator())
+    defer mem.dynamic_arena_destroy(&arena)
+    context.allocator = mem.dynamic_arena_allocator(&arena)
+
+    repo, repo_err := load_repo(context.allocator, true)
+    if repo_err != .None {
+        return false
+    }
+    names: [dynamic]string
+    for name in repo {
+        append(&names, name)
+    }
+    sort.quick_sort(names[:])
+
+    records: [dynamic]u8
+    blob: [dynamic]u8
+    count := 0
+    skipped := 0
+    for name in names {
+        chosen: map[string]string
+        order: [dynamic]struct {pkg: string, ver: string}
+        // Konflikty i cykle zostają dla solvera, który zgłosi je przy install
+        if resolve_deps_iterative(context.allocator, &repo, name, "", &chosen, &order) != .None {
+            skipped += 1
+            continue
+        }
+        seen := make(map[string]bool)
+        closure := strings.builder_make()
+        size: i64 = 0
+        for item in order {
+            key := fmt.aprintf("%s@%s", item.pkg, item.ver)
+            if seen[key] {
+                continue
+            }
+            seen[key] = true
+            if strings.builder_len(closure) > 0 {
+                strings.write_byte(&closure, ' ')
+            }
+            strings.write_string(&closure, key)
+            if ver_obj, ok := find_version(repo[item.pkg], item.ver); ok {
+                size += ver_obj.size
+            }
+        }
+        text := strings.to_string(closure)
+        put_u32le(&records, u32(len(blob)))
+        put_u32le(&records, u32(len(name)))
+        append(&blob, name)
+        put_u32le(&records, u32(len(blob)))
+        put_u32le(&records, u32(len(text)))
+        append(&blob, text)
+        put_u32le(&records, u32(u64(size) & 0xffffffff))
+        put_u32le(&records, u32(u64(size) >> 32))
+        count += 1
+    }
+
+    out: [dynamic]u8
+    append(&out, CLOSURE_INDEX_MAGIC)
+    put_u32le(&out, u32(count))
+    put_u32le(&out, u32(len(blob)))
+    sha_field: [64]u8
+    copy(sha_field[:], repo_sha)
+    append(&out, ..sha_field[:])
+    append(&out, ..records[:])
+    append(&out, ..blob[:])
+    if !os.write_entire_file(CLOSURE_INDEX_TMP, out[:]) {
+        return false
+    }
+    if os.rename(CLOSURE_INDEX_TMP, CLOSURE_INDEX_PATH) != os.ERROR_NONE {
+        os.remove(CLOSURE_INDEX_TMP)
+        return false
+    }
+    log_to_file("INFO", fmt.tprintf("closure index: %d packages, %d left to the solver", count, skipped))
+    return true
+}
+
+// Domknięcie pkg z indeksu; ok == false, gdy indeksu brak, jest nieaktualny
+// albo pakietu w nim nie ma — wtedy wołający używa resolve_deps_iterative
+lookup_closure :: proc(allocator: mem.Allocator, pkg: string) -> (items: [dynamic]PkgVer, size: i64, ok: bool) {
+    fd, err := os.open(CLOSURE_INDEX_PATH, os.O_RDONLY, 0)
+    if err != os.ERROR_NONE {
+        return
+    }
+    defer os.close(fd)
+    header: [CLOSURE_HEADER_SIZE]u8
+    n, rerr := os.read_at(fd, header[:], 0)
+    if rerr != os.ERROR_NONE || n != CLOSURE_HEADER_SIZE || string(header[:8]) != CLOSURE_INDEX_MAGIC {
+        return
+    }
+    meta := load_index_meta(allocator)
+    if strings.trim_right_null(string(header[16:80])) != meta.sha256 {
+        return
+    }
+    // Domknięcia liczono dla faktów hosta z chwili refresh. Po zmianie jądra
+    // czy libc load_repo filtruje wersje od nowa, więc do następnego refresh
+    // rozstrzyga solver.
+    if !host_index_current(allocator) {
+        return
+    }
+    count := int(get_u32le(header[8:]))
+    blob_off := i64(CLOSURE_HEADER_SIZE + CLOSURE_RECORD_SIZE * count)
+    read_blob :: proc(fd: os.Handle, at: i64, length: int) -> (string, bool) {
+        buf := make([]u8, length, context.temp_allocator)
+        n, err := os.read_at(fd, buf, at)
+        return string(buf), err == os.ERROR_NONE && n == length
+    }
+    rec: [CLOSURE_RECORD_SIZE]u8
+    lo, hi := 0, count
+    for lo < hi {
+        mid := (lo + hi) / 2
+        n, rerr = os.read_at(fd, rec[:], i64(CLOSURE_HEADER_SIZE + CLOSURE_RECORD_SIZE * mid))
+        if rerr != os.ERROR_NONE || n != CLOSURE_RECORD_SIZE {
+            return
+        }
+        name, rok := read_blob(fd, blob_off + i64(get_u32le(rec[0:])), int(get_u32le(rec[4:])))
+        if !rok {
+            return
+        }
+        if name == pkg {
+            text, tok := read_blob(fd, blob_off + i64(get_u32le(rec[8:])), int(get_u32le(rec[12:])))
+            if !tok {
+                return
+            }
+            for entry in strings.split(text, " ", context.temp_allocator) {
+                at := strings.last_index_byte(entry, '@')
+                if at <= 0 {
+                    continue
+                }
+                append(&items, PkgVer{strings.clone(entry[:at], allocator), strings.clone(entry[at+1:], allocator)})
+            }
+            size = i64(u64(get_u32le(rec[16:])) | u64(get_u32le(rec[20:])) << 32)
+            ok = true
+            return
+        }
+        if name < pkg {
+            lo = mid + 1
+        } else {
+            hi = mid
+        }
+    }
+    return
+}
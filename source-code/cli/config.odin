@@ -0,0 +1,66 @@
+package hpm
+
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:encoding/json"
+
+CONFIG_PATH := "/etc/hpm/config.json"
+
+DEFAULT_CACHE_MAX_BYTES :: 2 * 1024 * 1024 * 1024
+DEFAULT_DURABILITY :: "commit"
+DEFAULT_SEGMENT_THRESHOLD :: 32 * 1024 * 1024
+DEFAULT_SEGMENTS :: 4
+
+// Ustawienia z /etc/hpm/config.json; brakujące pola mają wartości domyślne.
+// mirrors: prefiks URL -> lista prefiksów luster, np.
+//   {"https://github.com/": ["https://mirror.example/github/"]}
+// peers: hosty z `hpm cache-serve`, pytane o archiwa przed originem, np.
+//   ["http://10.0.0.5:8765"]
+// prefetch_limit_rate: limit pasma dla `hpm prefetch` w składni curl (np. "2M")
+// segment_threshold: archiwa od tego rozmiaru idą kilkoma połączeniami (0 = nigdy),
+// segments: ile połączeń na plik
+Config :: struct {
+    cache_max_bytes:     i64,
+    durability:          string,
+    mirrors:             map[string][dynamic]string,
+    peers:               [dynamic]string,
+    prefetch_limit_rate: string,
+    segment_threshold:   i64,
+    segments:            int,
+}
+
+// Wczytywany raz w main
+config: Config
+
+// HPM_CONFIG pozwala wskazać inny plik (np. lokalne lustra w testach)
+config_path :: proc() -> string {
+    if path := os.get_env("HPM_CONFIG", context.temp_allocator); path != "" {
+        return path
+    }
+    return CONFIG_PATH
+}
+
+load_config :: proc(allocator: mem.Allocator) -> Config {
+    cfg := Config{
+        cache_max_bytes   = DEFAULT_CACHE_MAX_BYTES,
+        durability        = DEFAULT_DURABILITY,
+        segment_threshold = DEFAULT_SEGMENT_THRESHOLD,
+        segments          = DEFAULT_SEGMENTS,
+    }
+    data, ok := os.read_entire_file(config_path(), allocator)
+    if !ok {
+        return cfg
+    }
+    defer delete(data)
+    if json.unmarshal(data, &cfg, allocator = allocator) != nil {
+        log_to_file("WARN", fmt.tprintf("Invalid %s, using defaults", config_path()))
+        return Config{
+            cache_max_bytes   = DEFAULT_CACHE_MAX_BYTES,
+            durability        = DEFAULT_DURABILITY,
+            segment_threshold = DEFAULT_SEGMENT_THRESHOLD,
+            segments          = DEFAULT_SEGMENTS,
+        }
+    }
+    return cfg
+}
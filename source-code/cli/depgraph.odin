@@ -0,0 +1,277 @@
+package hpm
+
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:encoding/json"
+
+// Graf zależności zainstalowanych pakietów, utrzymywany przyrostowo przy każdej
+// transakcji obok state.json. deps opisuje aktywną wersję pakietu, rdeps to
+// odwrócone krawędzie; requested to pakiety zainstalowane na wyraźne żądanie.
+DEPGRAPH_PATH := "/var/lib/hpm/depgraph.json"
+DEPGRAPH_TMP  := "/var/lib/hpm/depgraph.json.tmp"
+
+DepGraph :: struct {
+    requested: map[string]bool,
+    deps:      map[string][dynamic]string,
+    rdeps:     map[string][dynamic]string,
+}
+
+// Wczytuje graf; gdy go brak (instalacja sprzed tej wersji), odbudowuje go
+// ze stanu, traktując wszystko jako żądane — autoremove niczego wtedy nie ruszy
+load_depgraph :: proc(allocator: mem.Allocator, state: ^StatePackages) -> DepGraph {
+    g: DepGraph
+    data, ok := os.read_entire_file(DEPGRAPH_PATH, allocator)
+    if ok {
+        defer delete(data)
+        if json.unmarshal(data, &g, allocator = allocator) == nil {
+            if g.requested == nil { g.requested = make(map[string]bool, allocator) }
+            if g.deps == nil { g.deps = make(map[string][dynamic]string, allocator) }
+            if g.rdeps == nil { g.rdeps = make(map[string][dynamic]string, allocator) }
+            return g
+        }
+        log_to_file("WARN", "Invalid depgraph.json, rebuilding")
+    }
+    g = DepGraph{
+        requested = make(map[string]bool, allocator),
+        deps      = make(map[string][dynamic]string, allocator),
+        rdeps     = make(map[string][dynamic]string, allocator),
+    }
+    installed, _ := get_installed(allocator, state)
+    defer delete(installed)
+    for pkg in installed {
+        g.requested[pkg] = true
+    }
+    rebuild_depgraph_edges(allocator, &g, state)
+    return g
+}
+
+save_depgraph :: proc(g: ^DepGraph, allocator: mem.Allocator) -> Error {
+    data, merr := json.marshal(g^, allocator = allocator)
+    if merr != nil {
+        return .StateLoadFailed
+    }
+    defer delete(data)
+    if !os.write_entire_file(DEPGRAPH_TMP, data) {
+        return .StateLoadFailed
+    }
+    if os.rename(DEPGRAPH_TMP, DEPGRAPH_PATH) != os.ERROR_NONE {
+        return .StateLoadFailed
+    }
+    return .None
+}
+
+// Odtwarza krawędzie z aktywnych wersji (po rollbacku i switch); requested zostaje.
+// Bez indeksu zostawia dotychczasowe krawędzie — pusty graf oznaczałby dla
+// autoremove, że żadna zależność nie jest już potrzebna.
+rebuild_depgraph_edges :: proc(allocator: mem.Allocator, g: ^DepGraph, state: ^StatePackages) {
+    repo, repo_err := load_repo(allocator, true, true)
+    if repo_err != .None {
+        log_to_file("WARN", "depgraph: package index unavailable, keeping previous edges")
+        return
+    }
+    defer deinit_repo(&repo, allocator)
+    clear(&g.deps)
+    clear(&g.rdeps)
+    installed, _ := get_installed(allocator, state)
+    defer delete(installed)
+    for pkg, ver in installed {
+        depgraph_set(g, &repo, pkg, ver)
+    }
+}
+
+// Ustawia krawędzie pkg według zależności wersji ver z indeksu
+depgraph_set :: proc(g: ^DepGraph, repo: ^Repo, pkg: string, ver: string) {
+    depgraph_unlink(g, pkg)
+    deps: [dynamic]string
+    if ver_obj, ok := find_version(repo^[pkg], ver); ok {
+        for dep in ver_obj.deps {
+            append(&deps, strings.clone(dep))
+            if dep not_in g.rdeps {
+                g.rdeps[strings.clone(dep)] = make([dynamic]string)
+            }
+            list := &g.rdeps[dep]
+            append(list, strings.clone(pkg))
+        }
+    }
+    g.deps[strings.clone(pkg)] = deps
+}
+
+// Usuwa wychodzące krawędzie pkg (i odpowiadające im wpisy w rdeps)
+depgraph_unlink :: proc(g: ^DepGraph, pkg: string) {
+    old, ok := g.deps[pkg]
+    if !ok {
+        return
+    }
+    for dep in old {
+        if dep in g.rdeps {
+            list := &g.rdeps[dep]
+            for i := 0; i < len(list^); i += 1 {
+                if list^[i] == pkg {
+                    unordered_remove(list, i)
+                    break
+                }
+            }
+            if len(list^) == 0 {
+                delete_key(&g.rdeps, dep)
+            }
+        }
+    }
+    delete_key(&g.deps, pkg)
+}
+
+// Pakiet zniknął ze stanu: bez krawędzi wychodzących i bez flagi requested
+depgraph_drop :: proc(g: ^DepGraph, pkg: string) {
+    depgraph_unlink(g, pkg)
+    delete_key(&g.requested, pkg)
+}
+
+// Zainstalowane pakiety zależne od pkg
+installed_dependents :: proc(g: ^DepGraph, state: ^StatePackages, pkg: string) -> [dynamic]string {
+    result: [dynamic]string
+    for dependent in g.rdeps[pkg] {
+        if dependent in state^ {
+            append(&result, dependent)
+        }
+    }
+    return result
+}
+
+// hpm why <pkg> — ścieżki od żądanych pakietów do pkg po odwróconych krawędziach
+why :: proc(allocator: mem.Allocator, pkg: string) -> Error {
+    state, state_err := load_state(allocator)
+    if state_err != .None {
+        return state_err
+    }
+    defer delete_state(&state, allocator)
+    if pkg not_in state {
+        fmt.printf("%sPackage %s%s%s not installed.%s\n", COLOR_RED, COLOR_CYAN, pkg, COLOR_RESET, COLOR_RESET)
+        return .PackageNotFound
+    }
+    g := load_depgraph(allocator, &state)
+    if g.requested[pkg] {
+        fmt.printf("%s%s%s was explicitly requested.\n", COLOR_CYAN, pkg, COLOR_RESET)
+    }
+    // BFS w górę grafu; parent pozwala odtworzyć najkrótszą ścieżkę do każdego korzenia
+    parent := make(map[string]string, allocator)
+    defer delete(parent)
+    queue: [dynamic]string
+    defer delete(queue)
+    append(&queue, pkg)
+    parent[pkg] = ""
+    roots := 0
+    for head := 0; head < len(queue); head += 1 {
+        node := queue[head]
+        for dependent in g.rdeps[node] {
+            if dependent in parent || dependent not_in state {
+                continue
+            }
+            parent[dependent] = node
+            append(&queue, dependent)
+            if !g.requested[dependent] {
+                continue
+            }
+            roots += 1
+            sb := strings.builder_make(context.temp_allocator)
+            for n := dependent; n != ""; n = parent[n] {
+                if n != dependent {
+                    strings.write_string(&sb, " → ")
+                }
+                strings.write_string(&sb, n)
+            }
+            fmt.printf("  %s\n", strings.to_string(sb))
+        }
+    }
+    if roots == 0 && !g.requested[pkg] {
+        fmt.printf("%s%s is not needed by any requested package (see 'hpm autoremove').%s\n", COLOR_YELLOW, pkg, COLOR_RESET)
+    }
+    return .None
+}
+
+// hpm autoremove [-y] — usuwa pakiety nieosiągalne z żądanych (ani przypięte)
+autoremove :: proc(allocator: mem.Allocator, args: []string) -> Error {
+    assume_yes := len(args) > 0 && (args[0] == "-y" || args[0] == "--yes")
+    lock_err := acquire_lock()
+    if lock_err != .None {
+        return lock_err
+    }
+    defer release_lock()
+    state, state_err := load_state(allocator)
+    if state_err != .None {
+        return state_err
+    }
+    defer delete_state(&state, allocator)
+    g := load_depgraph(allocator, &state)
+
+    reachable := make(map[string]bool, allocator)
+    defer delete(reachable)
+    queue: [dynamic]string
+    defer delete(queue)
+    for pkg, vers in state {
+        pinned := false
+        for _, vinfo in vers {
+            if vinfo.pinned {
+                pinned = true
+            }
+        }
+        if g.requested[pkg] || pinned {
+            reachable[pkg] = true
+            append(&queue, pkg)
+        }
+    }
+    for head := 0; head < len(queue); head += 1 {
+        for dep in g.deps[queue[head]] {
+            if dep in reachable || dep not_in state {
+                continue
+            }
+            reachable[dep] = true
+            append(&queue, dep)
+        }
+    }
+    orphans: [dynamic]string
+    defer delete(orphans)
+    for pkg in state {
+        if pkg not_in reachable {
+            append(&orphans, strings.clone(pkg, allocator))
+        }
+    }
+    if len(orphans) == 0 {
+        fmt.printf("%s✔ Nothing to autoremove.%s\n", COLOR_GREEN, COLOR_RESET)
+        return .None
+    }
+    fmt.printf("%sPackages no longer needed:%s\n", COLOR_BLUE, COLOR_RESET)
+    for pkg in orphans {
+        fmt.printf("  - %s%s%s\n", COLOR_CYAN, pkg, COLOR_RESET)
+    }
+    if !assume_yes {
+        fmt.printf("%sRemove them? [y/N] %s", COLOR_YELLOW, COLOR_RESET)
+        input: [1024]u8
+        n, _ := os.read(os.stdin, input[:])
+        if !strings.equal_fold(strings.trim_space(string(input[:n])), "y") {
+            fmt.printf("%sAutoremove cancelled.%s\n", COLOR_YELLOW, COLOR_RESET)
+            return .None
+        }
+    }
+    for pkg in orphans {
+        if err := remove_all_versions(allocator, &state, pkg); err != .None {
+            save_state(&state, allocator)
+            save_depgraph(&g, allocator)
+            return err
+        }
+        depgraph_drop(&g, pkg)
+    }
+    durable_barrier(STORE_PATH, STATE_PATH)
+    save_err := save_state(&state, allocator)
+    if save_err != .None {
+        return save_err
+    }
+    save_depgraph(&g, allocator)
+    gen_err := commit_generation(allocator, &state)
+    if gen_err != .None {
+        return gen_err
+    }
+    collect_unreferenced(allocator, &state)
+    fmt.printf("%s✔ Removed %d unneeded package(s).%s\n", COLOR_GREEN, len(orphans), COLOR_RESET)
+    return .None
+}
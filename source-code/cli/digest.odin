@@ -0,0 +1,55 @@
+package hpm
+
+import "core:fmt"
+import "core:mem"
+import "core:strings"
+
+// Skróty archiwów i drzew w indeksie i stanie mogą być w różnych algorytmach.
+// Wewnątrz hpm skrót to napis "<algo>:<hex>", a dla sha256 samo "<hex>",
+// więc istniejące wpisy i state.json czyta się bez zmian. BLAKE3 liczy backend
+// w trybie drzewa, na wszystkich rdzeniach.
+DIGEST_SHA256 :: "sha256"
+DIGEST_BLAKE3 :: "blake3"
+
+digest_algo_supported :: proc(algo: string) -> bool {
+    return algo == DIGEST_SHA256 || algo == DIGEST_BLAKE3
+}
+
+tag_digest :: proc(algo: string, hex: string) -> string {
+    if hex == "" || algo == "" || algo == DIGEST_SHA256 {
+        return hex
+    }
+    return fmt.tprintf("%s:%s", algo, hex)
+}
+
+split_digest :: proc(digest: string) -> (algo: string, hex: string) {
+    if colon := strings.index_byte(digest, ':'); colon > 0 {
+        return digest[:colon], digest[colon+1:]
+    }
+    return DIGEST_SHA256, digest
+}
+
+// Oczekiwany skrót archiwum wersji; wpisy bez digest_algo to sha256 z pola sha256
+archive_digest :: proc(v: RepoVersion) -> string {
+    if v.digest != "" {
+        return tag_digest(v.digest_algo, v.digest)
+    }
+    return v.sha256
+}
+
+// Liczy skrót pliku w algorytmie skrótu expected i porównuje
+verify_file_digest :: proc(allocator: mem.Allocator, path: string, expected: string) -> bool {
+    algo, hex := split_digest(expected)
+    switch algo {
+        case DIGEST_SHA256:
+            got, err := compute_sha256_stream(allocator, path)
+            defer delete(got, allocator)
+            return err == .None && got == hex
+        case DIGEST_BLAKE3:
+            got, ok := backend_hash(allocator, path, DIGEST_BLAKE3)
+            defer delete(got, allocator)
+            return ok && got == hex
+    }
+    log_to_file("ERROR", fmt.tprintf("Unsupported digest algorithm '%s'", algo))
+    return false
+}
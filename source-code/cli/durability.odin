@@ -0,0 +1,145 @@
+package hpm
+
+import "core:fmt"
+import "core:strings"
+import "core:sys/linux"
+
+// Poziomy trwałości transakcji:
+//   none   — żadnych fsync; po utracie zasilania paczka może być pusta,
+//   commit — jedna bariera syncfs przed zapisem stanu i przełączeniem symlinków
+//            (domyślnie; koszt stały na transakcję, nie na plik),
+//   strict — dodatkowo backend robi fsync każdego rozpakowanego pliku i katalogu.
+Durability :: enum {
+    None,
+    Commit,
+    Strict,
+}
+
+// Ustawiane raz w main: z config.json, a potem z --durability=...
+durability := Durability.Commit
+
+parse_durability :: proc(s: string) -> (Durability, bool) {
+    switch s {
+        case "none":
+            return .None, true
+        case "commit":
+            return .Commit, true
+        case "strict":
+            return .Strict, true
+    }
+    return .Commit, false
+}
+
+durability_name :: proc(d: Durability) -> string {
+    switch d {
+        case .None:
+            return "none"
+        case .Commit:
+            return "commit"
+        case .Strict:
+            return "strict"
+    }
+    return "commit"
+}
+
+// Wycina opcje globalne z argumentów: --durability=<tryb> i --paranoid.
+// Mogą stać przed poleceniem i po nim, ale nie za `run` ani za `--` —
+// dalej są argumenty uruchamianego narzędzia i zostają nietknięte.
+take_global_flags :: proc(args: []string) -> ([]string, bool) {
+    rest: [dynamic]string
+    end := global_flags_end(args)
+    for arg in args[:end] {
+        if arg == "--paranoid" {
+            paranoid = true
+            continue
+        }
+        if strings.has_prefix(arg, "--durability=") {
+            d, ok := parse_durability(strings.trim_prefix(arg, "--durability="))
+            if !ok {
+                return nil, false
+            }
+            durability = d
+            continue
+        }
+        append(&rest, arg)
+    }
+    append(&rest, ..args[end:])
+    return rest[:], true
+}
+
+// Indeks, od którego argumenty nie należą już do hpm
+global_flags_end :: proc(args: []string) -> int {
+    command := ""
+    for i := 0; i < len(args); i += 1 {
+        arg := args[i]
+        if arg == "--" {
+            return i
+        }
+        if arg == "--root" {
+            i += 1
+            continue
+        }
+        if command == "" && !strings.has_prefix(arg, "-") {
+            command = arg
+            if command == "run" {
+                return i + 1
+            }
+        }
+    }
+    return len(args)
+}
+
+// syncfs na systemie plików, na którym leży path
+sync_filesystem :: proc(path: string) -> bool {
+    fd, err := linux.open(strings.clone_to_cstring(path, context.temp_allocator), {.DIRECTORY})
+    if err != .NONE {
+        return false
+    }
+    defer linux.close(fd)
+    return linux.syncfs(fd) == .NONE
+}
+
+// fsync pliku albo katalogu (dla katalogu utrwala wpisy po rename)
+fsync_path :: proc(path: string) -> bool {
+    fd, err := linux.open(strings.clone_to_cstring(path, context.temp_allocator), {})
+    if err != .NONE {
+        return false
+    }
+    defer linux.close(fd)
+    return linux.fsync(fd) == .NONE
+}
+
+// Bariera transakcji: wszystko zapisane do tej pory w store trafia na dysk,
+// zanim stan i symlinki zaczną na to wskazywać. Jeden syncfs na system plików.
+durable_barrier :: proc(paths: ..string) {
+    if durability == .None {
+        return
+    }
+    seen: [dynamic]u64
+    defer delete(seen)
+    outer: for path in paths {
+        st: linux.Stat
+        if linux.stat(strings.clone_to_cstring(path, context.temp_allocator), &st) != .NONE {
+            continue
+        }
+        for dev in seen {
+            if dev == u64(st.dev) {
+                continue outer
+            }
+        }
+        append(&seen, u64(st.dev))
+        if !sync_filesystem(path) {
+            log_to_file("WARN", fmt.tprintf("syncfs failed for %s", path))
+        }
+    }
+}
+
+// Po rename: utrwala wpis w katalogu nadrzędnym (bez pełnego syncfs)
+durable_rename_done :: proc(dir: string) {
+    if durability == .None {
+        return
+    }
+    if !fsync_path(dir) {
+        log_to_file("WARN", fmt.tprintf("fsync failed for %s", dir))
+    }
+}
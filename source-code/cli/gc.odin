@@ -0,0 +1,365 @@
+package hpm
+
+import "base:intrinsics"
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:strconv"
+import "core:thread"
+import "core:sys/linux"
+
+// Kosz w tym samym systemie plików co store, więc przeniesienie to zwykły rename()
+TRASH_PATH := "/usr/lib/HackerOS/hpm/store/.trash/"
+DEFAULT_KEEP_GENERATIONS :: 3
+MAX_PARALLEL_DELETES :: 4
+
+GcReport :: struct {
+    versions:   int,
+    leftovers:  int,
+    generations: int,
+    bytes:      i64,
+}
+
+// Suma rozmiarów plików w drzewie (bez podążania za symlinkami)
+dir_size :: proc(path: string) -> i64 {
+    total: i64 = 0
+    dir, err := os.open(path)
+    if err != os.ERROR_NONE {
+        return 0
+    }
+    defer os.close(dir)
+    files, _ := os.read_dir(dir, -1)
+    defer os.file_info_slice_delete(files)
+    for file in files {
+        st, serr := os.lstat(file.fullpath)
+        if serr != os.ERROR_NONE {
+            continue
+        }
+        defer os.file_info_delete(st)
+        if os.S_ISLNK(u32(st.mode)) {
+            continue
+        }
+        if st.is_dir {
+            total += dir_size(file.fullpath)
+        } else {
+            total += st.size
+        }
+    }
+    return total
+}
+
+// Przenosi ścieżkę do kosza pod unikalną nazwą; usuwanie odbywa się później
+move_to_trash :: proc(path: string, label: string) -> bool {
+    if !makedirs(TRASH_PATH) {
+        return false
+    }
+    dest := fmt.tprintf("%s%s-%d-%d", TRASH_PATH, label, int(linux.getpid()), trash_counter)
+    trash_counter += 1
+    return os.rename(path, dest) == os.ERROR_NONE
+}
+
+@(private="file")
+trash_counter := 0
+
+// Wersje, które muszą zostać: aktywne, przypięte, z ostatnich `keep`
+// generacji oraz ich domknięcia zależności wśród zainstalowanych wersji.
+compute_live_set :: proc(allocator: mem.Allocator, state: ^StatePackages, keep: int) -> map[string]bool {
+    live := make(map[string]bool, allocator)
+    queue: [dynamic]PkgVer
+    defer delete(queue)
+    mark :: proc(live: ^map[string]bool, queue: ^[dynamic]PkgVer, pkg: string, ver: string) {
+        key := fmt.aprintf("%s@%s", pkg, ver)
+        if live^[key] {
+            return
+        }
+        live^[key] = true
+        append(queue, PkgVer{pkg, ver})
+    }
+
+    installed, _ := get_installed(allocator, state)
+    defer delete(installed)
+    for pkg, ver in installed {
+        mark(&live, &queue, pkg, ver)
+    }
+    for pkg, vers in state^ {
+        for ver, vinfo in vers {
+            if vinfo.pinned {
+                mark(&live, &queue, pkg, ver)
+            }
+        }
+    }
+    gens := list_generations(allocator)
+    defer delete(gens)
+    current, has_current := current_generation(allocator)
+    for g, i in gens {
+        if i < len(gens) - keep && !(has_current && g == current) {
+            continue
+        }
+        m, err := load_generation(allocator, g)
+        if err != .None {
+            continue
+        }
+        for pkg, ver in m.packages {
+            mark(&live, &queue, pkg, ver)
+        }
+    }
+
+    // Domknięcie zależności — bez indeksu pakietów zostajemy przy korzeniach
+    repo, repo_err := load_repo(allocator, true, true)
+    if repo_err != .None {
+        return live
+    }
+    defer deinit_repo(&repo, allocator)
+    for len(queue) > 0 {
+        item := pop(&queue)
+        pkg, ok := repo[item.pkg]
+        if !ok {
+            continue
+        }
+        ver_obj, vok := find_version(pkg, item.ver)
+        if !vok {
+            continue
+        }
+        for dep, req in ver_obj.deps {
+            vers, dok := state^[dep]
+            if !dok {
+                continue
+            }
+            for ver in vers {
+                if satisfies(ver, req) {
+                    mark(&live, &queue, dep, ver)
+                }
+            }
+        }
+    }
+    return live
+}
+
+TrashJob :: struct {
+    path:  string,
+    bytes: i64,
+    ok:    bool,
+}
+
+trash_worker :: proc(t: ^thread.Thread) {
+    jobs := (^[]TrashJob)(t.data)^
+    for i := t.user_index; i < len(jobs); i += MAX_PARALLEL_DELETES {
+        job := &jobs[i]
+        job.bytes = dir_size(job.path)
+        job.ok = remove_tree(job.path)
+    }
+}
+
+// Kasuje zawartość kosza równolegle; zwraca liczbę odzyskanych bajtów
+empty_trash :: proc(allocator: mem.Allocator) -> i64 {
+    // Ta sama blokada katalogu co w backend reap — inaczej reaper uruchomiony
+    // przez remove/update kasowałby te same drzewa równolegle z nami
+    lock_fd, lerr := linux.open(strings.clone_to_cstring(TRASH_PATH, context.temp_allocator), {.DIRECTORY, .CLOEXEC})
+    if lerr != .NONE {
+        return 0
+    }
+    defer linux.close(lock_fd)
+    if int(intrinsics.syscall(linux.SYS_flock, uintptr(lock_fd), uintptr(LOCK_EX))) < 0 {
+        return 0
+    }
+    dir, err := os.open(TRASH_PATH)
+    if err != os.ERROR_NONE {
+        return 0
+    }
+    files, _ := os.read_dir(dir, -1, allocator)
+    os.close(dir)
+    defer delete(files)
+    if len(files) == 0 {
+        return 0
+    }
+    jobs := make([]TrashJob, len(files), allocator)
+    defer delete(jobs)
+    for file, i in files {
+        jobs[i] = TrashJob{path = file.fullpath}
+    }
+    jobs_ref := jobs
+    threads: [dynamic]^thread.Thread
+    defer delete(threads)
+    for i in 0..<min(MAX_PARALLEL_DELETES, len(jobs)) {
+        t := thread.create(trash_worker)
+        t.data = rawptr(&jobs_ref)
+        t.user_index = i
+        thread.start(t)
+        append(&threads, t)
+    }
+    for t in threads {
+        thread.join(t)
+        thread.destroy(t)
+    }
+    total: i64 = 0
+    for job in jobs {
+        if job.ok {
+            total += job.bytes
+        } else {
+            log_to_file("WARN", fmt.tprintf("gc: failed to delete %s", job.path))
+        }
+    }
+    return total
+}
+
+// Zleca backendowi skasowanie kosza w tle (niski priorytet CPU i I/O),
+// żeby remove/update nie czekały na rekurencyjne usuwanie drzew
+spawn_reaper :: proc() {
+    if !spawn_detached(backend_command("reap")) {
+        log_to_file("WARN", "Failed to start background reaper")
+    }
+}
+
+// Po transakcji: przenosi do kosza wersje, do których nie sięga już żadna
+// z ostatnich generacji, i zleca kasowanie w tle. Wołający trzyma LOCK_PATH.
+collect_unreferenced :: proc(allocator: mem.Allocator, state: ^StatePackages) -> int {
+    report := gc_store(allocator, state, DEFAULT_KEEP_GENERATIONS)
+    if report.versions > 0 {
+        save_state(state, allocator)
+    }
+    spawn_reaper()
+    return report.versions
+}
+
+// Faza pod blokadą: wylicza zbiór żywy i przenosi resztę do kosza.
+// Wywołujący musi trzymać LOCK_PATH.
+gc_store :: proc(allocator: mem.Allocator, state: ^StatePackages, keep: int) -> GcReport {
+    report: GcReport
+    live := compute_live_set(allocator, state, keep)
+    defer delete(live)
+    graph := load_depgraph(allocator, state)
+    graph_changed := false
+
+    store, err := os.open(STORE_PATH)
+    if err == os.ERROR_NONE {
+        pkgs, _ := os.read_dir(store, -1, allocator)
+        os.close(store)
+        for pkg_entry in pkgs {
+            if !pkg_entry.is_dir || strings.has_prefix(pkg_entry.name, ".") {
+                continue
+            }
+            pkg := pkg_entry.name
+            pkg_dir, perr := os.open(pkg_entry.fullpath)
+            if perr != os.ERROR_NONE {
+                continue
+            }
+            entries, _ := os.read_dir(pkg_dir, -1, allocator)
+            os.close(pkg_dir)
+            for entry in entries {
+                name := entry.name
+                if name == "current" || name == "current.tmp" {
+                    continue
+                }
+                leftover := strings.has_suffix(name, ".tmp") || strings.has_suffix(name, ".old")
+                if !leftover && (!entry.is_dir || live[fmt.tprintf("%s@%s", pkg, name)]) {
+                    continue
+                }
+                if !move_to_trash(entry.fullpath, fmt.tprintf("%s-%s", pkg, name)) {
+                    log_to_file("WARN", fmt.tprintf("gc: cannot move %s to trash", entry.fullpath))
+                    continue
+                }
+                if leftover {
+                    report.leftovers += 1
+                } else {
+                    report.versions += 1
+                    if vers, ok := state^[pkg]; ok {
+                        delete_key(&vers, name)
+                        state^[pkg] = vers
+                        if len(vers) == 0 {
+                            delete_key(state, pkg)
+                            depgraph_drop(&graph, pkg)
+                            graph_changed = true
+                        }
+                    }
+                }
+            }
+            delete(entries)
+            // rmdir zadziała tylko dla pustego katalogu pakietu
+            os.remove_directory(pkg_entry.fullpath)
+        }
+        delete(pkgs)
+    }
+    if graph_changed {
+        save_depgraph(&graph, allocator)
+    }
+
+    gens := list_generations(allocator)
+    defer delete(gens)
+    current, has_current := current_generation(allocator)
+    for g, i in gens {
+        if i >= len(gens) - keep || (has_current && g == current) {
+            continue
+        }
+        if move_to_trash(generation_path(g), fmt.tprintf("gen-%d", g)) {
+            report.generations += 1
+        }
+    }
+    if leftovers, perr := os.open(PROFILES_PATH); perr == os.ERROR_NONE {
+        entries, _ := os.read_dir(leftovers, -1, allocator)
+        os.close(leftovers)
+        for entry in entries {
+            if strings.has_suffix(entry.name, ".tmp") && move_to_trash(entry.fullpath, entry.name) {
+                report.leftovers += 1
+            }
+        }
+        delete(entries)
+    }
+    return report
+}
+
+gc :: proc(allocator: mem.Allocator, args: []string) -> Error {
+    keep := DEFAULT_KEEP_GENERATIONS
+    for i := 0; i < len(args); i += 1 {
+        if args[i] == "--keep" && i + 1 < len(args) {
+            n, ok := strconv.parse_int(args[i+1])
+            if !ok || n < 1 {
+                return .InvalidArgs
+            }
+            keep = n
+            i += 1
+        }
+    }
+    // Z crona: jeśli trwa inna operacja, po prostu spróbuj następnym razem
+    if lock_busy() {
+        fmt.printf("%sAnother operation in progress, skipping gc.%s\n", COLOR_YELLOW, COLOR_RESET)
+        return .None
+    }
+    lock_err := acquire_lock()
+    if lock_err != .None {
+        return lock_err
+    }
+    state, state_err := load_state(allocator)
+    if state_err != .None {
+        release_lock()
+        return state_err
+    }
+    defer delete_state(&state, allocator)
+    log_to_file("INFO", fmt.tprintf("gc: keeping last %d generations", keep))
+    report := gc_store(allocator, &state, keep)
+    save_err := save_state(&state, allocator)
+    release_lock()
+    if save_err != .None {
+        return save_err
+    }
+
+    // Właściwe kasowanie bez blokady; przerwane zostanie dokończone przy następnym gc
+    report.bytes = empty_trash(allocator)
+    fmt.printf("%s✔ gc: removed %d version(s), %d leftover(s), %d generation(s); reclaimed %s.%s\n",
+        COLOR_GREEN, report.versions, report.leftovers, report.generations, format_bytes(report.bytes), COLOR_RESET)
+    return .None
+}
+
+format_bytes :: proc(n: i64) -> string {
+    units := [?]string{"B", "KiB", "MiB", "GiB", "TiB"}
+    value := f64(n)
+    unit := 0
+    for value >= 1024 && unit < len(units) - 1 {
+        value /= 1024
+        unit += 1
+    }
+    if unit == 0 {
+        return fmt.tprintf("%d B", n)
+    }
+    return fmt.tprintf("%.1f %s", value, units[unit])
+}
@@ -0,0 +1,364 @@
+package hpm
+
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:strconv"
+import "core:sort"
+import "core:time"
+import "core:path/filepath"
+import "core:encoding/json"
+
+// Generacja to niezmienny katalog profiles/gen-N:
+//   pkgs/<pkg>     -> store/<pkg>/<ver>
+//   bin/<bin>      skrypt wywołujący backend run
+//   packages.json  lista pkg -> ver i skróty tych wersji
+// /usr/bin/<bin> to symlink do profile/bin/<bin>, a profile to symlink do
+// profiles/gen-N, więc jeden rename() przełącza cały zestaw naraz.
+PROFILES_PATH := "/usr/lib/HackerOS/hpm/profiles/"
+PROFILE_LINK  := "/usr/lib/HackerOS/hpm/profile"
+GENERATION_PREFIX :: "gen-"
+
+GenerationManifest :: struct {
+    created:   time.Time,
+    packages:  map[string]string,
+    // pkg -> skrót wersji z packages; rollback odtwarza z niego wpis w stanie
+    // dla wersji usuniętej po tej generacji (brak w starszych generacjach)
+    checksums: map[string]string,
+}
+
+generation_path :: proc(gen: int) -> string {
+    return fmt.tprintf("%s%s%d", PROFILES_PATH, GENERATION_PREFIX, gen)
+}
+
+parse_generation :: proc(name: string) -> (int, bool) {
+    if !strings.has_prefix(name, GENERATION_PREFIX) {
+        return 0, false
+    }
+    n, ok := strconv.parse_int(strings.trim_prefix(name, GENERATION_PREFIX))
+    return n, ok
+}
+
+// Zwraca numery istniejących generacji, rosnąco
+list_generations :: proc(allocator: mem.Allocator) -> [dynamic]int {
+    gens := make([dynamic]int, allocator)
+    dir, err := os.open(PROFILES_PATH)
+    if err != os.ERROR_NONE {
+        return gens
+    }
+    defer os.close(dir)
+    files, _ := os.read_dir(dir, -1, allocator)
+    defer delete(files)
+    for file in files {
+        if n, ok := parse_generation(file.name); ok && file.is_dir {
+            append(&gens, n)
+        }
+    }
+    sort.quick_sort(gens[:])
+    return gens
+}
+
+current_generation :: proc(allocator: mem.Allocator) -> (int, bool) {
+    target, ok := readlink(PROFILE_LINK, allocator)
+    if !ok {
+        return 0, false
+    }
+    return parse_generation(filepath.base(target))
+}
+
+load_generation :: proc(allocator: mem.Allocator, gen: int) -> (GenerationManifest, Error) {
+    manifest_path := fmt.tprintf("%s/packages.json", generation_path(gen))
+    data, ok := os.read_entire_file(manifest_path, allocator)
+    if !ok {
+        return {}, .GenerationNotFound
+    }
+    defer delete(data)
+    m: GenerationManifest
+    if json.unmarshal(data, &m, allocator = allocator) != nil {
+        return {}, .GenerationNotFound
+    }
+    return m, .None
+}
+
+// Buduje nową generację z aktualnych symlinków current i aktywuje ją
+commit_generation :: proc(allocator: mem.Allocator, state: ^StatePackages) -> Error {
+    installed, inst_err := get_installed(allocator, state)
+    if inst_err != .None {
+        return inst_err
+    }
+    defer delete(installed)
+
+    if !makedirs(PROFILES_PATH) {
+        log_to_file("ERROR", fmt.tprintf("Failed to create %s", PROFILES_PATH))
+        return .GenerationFailed
+    }
+    gens := list_generations(allocator)
+    defer delete(gens)
+    gen := len(gens) > 0 ? gens[len(gens)-1] + 1 : 1
+
+    gen_dir := generation_path(gen)
+    gen_tmp := fmt.tprintf("%s.tmp", gen_dir)
+    remove_tree(gen_tmp)
+    if !makedirs(fmt.tprintf("%s/pkgs", gen_tmp)) || !makedirs(fmt.tprintf("%s/bin", gen_tmp)) {
+        log_to_file("ERROR", fmt.tprintf("Failed to create %s", gen_tmp))
+        return .GenerationFailed
+    }
+
+    m := GenerationManifest{created = time.now(), packages = installed, checksums = make(map[string]string, allocator)}
+    defer delete(m.checksums)
+    // Binarki poprzedniej generacji, których nowa nie ma, znikają z /usr/bin po przełączeniu
+    prev, has_prev := current_generation(allocator)
+    old_bins := has_prev ? generation_bins(allocator, prev) : make(map[string]bool, allocator)
+    defer delete(old_bins)
+    new_bins := make(map[string]bool, allocator)
+    defer delete(new_bins)
+    for pkg, ver in installed {
+        if vinfo, ok := state^[pkg][ver]; ok && vinfo.checksum != "" && vinfo.checksum != "none" {
+            m.checksums[pkg] = tag_digest(vinfo.digest_algo, vinfo.checksum)
+        }
+        pkg_path := fmt.tprintf("%s%s/%s", STORE_PATH, pkg, ver)
+        if !atomic_symlink(unrooted(pkg_path), fmt.tprintf("%s/pkgs/%s", gen_tmp, pkg)) {
+            remove_tree(gen_tmp)
+            return .GenerationFailed
+        }
+        manifest, man_err := load_manifest(allocator, pkg_path)
+        if man_err != .None {
+            log_to_file("WARN", fmt.tprintf("No manifest for %s@%s, skipping its binaries", pkg, ver))
+            continue
+        }
+        defer deinit_manifest(&manifest, allocator)
+        for bin in manifest.bins {
+            shim_err := write_wrapper(pkg, bin, fmt.tprintf("%s/bin", gen_tmp))
+            if shim_err != .None {
+                remove_tree(gen_tmp)
+                return shim_err
+            }
+            link_err := link_bin(allocator, bin)
+            if link_err != .None {
+                remove_tree(gen_tmp)
+                return link_err
+            }
+            new_bins[bin] = true
+        }
+    }
+    data, merr := json.marshal(m, allocator = allocator)
+    if merr != nil {
+        remove_tree(gen_tmp)
+        return .GenerationFailed
+    }
+    defer delete(data)
+    if !os.write_entire_file(fmt.tprintf("%s/packages.json", gen_tmp), data) {
+        remove_tree(gen_tmp)
+        return .GenerationFailed
+    }
+    // Generacja musi być na dysku, zanim profil zacznie na nią wskazywać
+    durable_barrier(PROFILES_PATH)
+    if os.rename(gen_tmp, gen_dir) != os.ERROR_NONE {
+        remove_tree(gen_tmp)
+        return .GenerationFailed
+    }
+    durable_rename_done(PROFILES_PATH)
+    act_err := activate_generation(gen)
+    if act_err != .None {
+        return act_err
+    }
+    for bin in old_bins {
+        if bin not_in new_bins {
+            unlink_bin(allocator, bin)
+        }
+    }
+    return .None
+}
+
+activate_generation :: proc(gen: int) -> Error {
+    // Względny cel, żeby link działał także po zamontowaniu drzewa gdzie indziej
+    target := fmt.tprintf("profiles/%s%d", GENERATION_PREFIX, gen)
+    if !atomic_symlink(target, PROFILE_LINK) {
+        log_to_file("ERROR", fmt.tprintf("Failed to activate generation %d", gen))
+        return .GenerationFailed
+    }
+    durable_rename_done(filepath.dir(PROFILE_LINK, context.temp_allocator))
+    log_to_file("INFO", fmt.tprintf("Activated generation %d", gen))
+    return .None
+}
+
+// /usr/bin/<bin> -> profile/bin/<bin>; stare wrappery-skrypty są podmieniane
+link_bin :: proc(allocator: mem.Allocator, bin: string) -> Error {
+    bin_link := fmt.tprintf("%s%s", BIN_PATH, bin)
+    shim := fmt.tprintf("%s/bin/%s", unrooted(PROFILE_LINK), bin)
+    if target, ok := readlink(bin_link, allocator); ok && target == shim {
+        return .None
+    }
+    if !atomic_symlink(shim, bin_link) {
+        log_to_file("ERROR", fmt.tprintf("Failed to link %s -> %s", bin_link, shim))
+        return .SymlinkFailed
+    }
+    return .None
+}
+
+// Usuwa /usr/bin/<bin>, o ile to nasz link do profilu, a nie cudzy plik
+unlink_bin :: proc(allocator: mem.Allocator, bin: string) {
+    bin_link := fmt.tprintf("%s%s", BIN_PATH, bin)
+    shim := fmt.tprintf("%s/bin/%s", unrooted(PROFILE_LINK), bin)
+    if target, ok := readlink(bin_link, allocator); ok && target == shim {
+        os.remove(bin_link)
+    }
+}
+
+generation_bins :: proc(allocator: mem.Allocator, gen: int) -> map[string]bool {
+    bins := make(map[string]bool, allocator)
+    dir, err := os.open(fmt.tprintf("%s/bin", generation_path(gen)))
+    if err != os.ERROR_NONE {
+        return bins
+    }
+    defer os.close(dir)
+    files, _ := os.read_dir(dir, -1, allocator)
+    defer delete(files)
+    for file in files {
+        bins[file.name] = true
+    }
+    return bins
+}
+
+rollback :: proc(allocator: mem.Allocator, target_spec: string) -> Error {
+    lock_err := acquire_lock()
+    if lock_err != .None {
+        return lock_err
+    }
+    defer release_lock()
+    current, has_current := current_generation(allocator)
+    if !has_current {
+        return .GenerationNotFound
+    }
+    target := 0
+    if target_spec != "" {
+        n, ok := strconv.parse_int(target_spec)
+        if !ok {
+            return .InvalidArgs
+        }
+        target = n
+    } else {
+        gens := list_generations(allocator)
+        defer delete(gens)
+        for g in gens {
+            if g < current {
+                target = g
+            }
+        }
+    }
+    if target == 0 || target == current {
+        return .GenerationNotFound
+    }
+    m, load_err := load_generation(allocator, target)
+    if load_err != .None {
+        return load_err
+    }
+    defer delete(m.packages)
+    for pkg, ver in m.packages {
+        if !os.exists(fmt.tprintf("%s%s/%s", STORE_PATH, pkg, ver)) {
+            fmt.printf("%s✖ %s@%s from generation %d is no longer in the store.%s\n", COLOR_RED, pkg, ver, target, COLOR_RESET)
+            return .GenerationNotFound
+        }
+    }
+    // Stan przed przełączeniem: wersje usunięte po tej generacji wracają
+    // ze skrótem z manifestu, żeby verify i gc widziały je od razu
+    state, state_err := load_state(allocator)
+    if state_err != .None {
+        return state_err
+    }
+    defer delete_state(&state, allocator)
+    restored := false
+    for pkg, ver in m.packages {
+        if _, ok := state[pkg][ver]; !ok {
+            checksum, has_checksum := m.checksums[pkg]
+            record_version(allocator, &state, pkg, ver, has_checksum ? checksum : "none")
+            restored = true
+        }
+    }
+    if restored {
+        if save_err := save_state(&state, allocator); save_err != .None {
+            return save_err
+        }
+        durable_barrier(STATE_PATH)
+    }
+    before, inst_err := get_installed(allocator, &state)
+    if inst_err != .None {
+        return inst_err
+    }
+    defer delete(before)
+
+    // Binarki bierzemy z katalogów bin/ obu generacji, bez czytania manifestów.
+    // Najpierw dowiąż brakujące (wiszą, dopóki profil się nie przełączy).
+    old_bins := generation_bins(allocator, current)
+    defer delete(old_bins)
+    new_bins := generation_bins(allocator, target)
+    defer delete(new_bins)
+    for bin in new_bins {
+        link_bin(allocator, bin)
+    }
+    // Jedyne przełączenie widoczne dla uruchamianych programów: backend run
+    // rozwiązuje pakiety przez profile/pkgs
+    act_err := activate_generation(target)
+    if act_err != .None {
+        return act_err
+    }
+    for bin in old_bins {
+        if bin not_in new_bins {
+            unlink_bin(allocator, bin)
+        }
+    }
+
+    // Symlinki current to już tylko zapis dla CLI; dotykamy wyłącznie pakietów,
+    // które różnią się między dotychczasowym a nowym zestawem, i tylko ich
+    // krawędzie w grafie. Pakiety spoza generacji tracą current, ale zostają w store do gc.
+    graph := load_depgraph(allocator, &state)
+    changed: [dynamic]PkgVer
+    defer delete(changed)
+    for pkg, ver in m.packages {
+        if before[pkg] != ver {
+            atomic_symlink(ver, fmt.tprintf("%s%s/current", STORE_PATH, pkg))
+            append(&changed, PkgVer{pkg, ver})
+        }
+    }
+    for pkg in before {
+        if pkg not_in m.packages {
+            os.remove(fmt.tprintf("%s%s/current", STORE_PATH, pkg))
+            depgraph_unlink(&graph, pkg)
+        }
+    }
+    if len(changed) > 0 {
+        if repo, repo_err := load_repo(allocator, true, true); repo_err == .None {
+            for item in changed {
+                depgraph_set(&graph, &repo, item.pkg, item.ver)
+            }
+            deinit_repo(&repo, allocator)
+        } else {
+            log_to_file("WARN", "depgraph: package index unavailable, keeping previous edges")
+        }
+    }
+    save_depgraph(&graph, allocator)
+    fmt.printf("%s✔ Rolled back from generation %d to %d.%s\n", COLOR_GREEN, current, target, COLOR_RESET)
+    return .None
+}
+
+generations :: proc(allocator: mem.Allocator) -> Error {
+    gens := list_generations(allocator)
+    defer delete(gens)
+    if len(gens) == 0 {
+        fmt.printf("%sNo generations yet.%s\n", COLOR_YELLOW, COLOR_RESET)
+        return .None
+    }
+    current, _ := current_generation(allocator)
+    fmt.printf("%sGeneration%s\t%sCreated%s\t%sPackages%s\n", COLOR_CYAN, COLOR_RESET, COLOR_CYAN, COLOR_RESET, COLOR_CYAN, COLOR_RESET)
+    for g in gens {
+        m, err := load_generation(allocator, g)
+        if err != .None {
+            continue
+        }
+        marker := g == current ? " (current)" : ""
+        fmt.printf("%s%d%s%s\t%v\t%d\n", COLOR_MAGENTA, g, marker, COLOR_RESET, m.created, len(m.packages))
+        delete(m.packages)
+    }
+    return .None
+}
@@ -0,0 +1,154 @@
+package hpm
+
+import "base:runtime"
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:encoding/json"
+
+// Indeks skompilowany dla tego hosta: repo.json bez wersji, których specs
+// (arch, libc, kernel z sekcji [specs] manifestu) wykluczają ten system,
+// i bez pakietów, którym nie została żadna wersja. Budowany przy refresh;
+// load_repo czyta go zamiast pełnego indeksu, dopóki pasuje odcisk w meta.
+HOST_INDEX_PATH := "/usr/lib/HackerOS/hpm/repo.host.json"
+HOST_INDEX_TMP  := "/usr/lib/HackerOS/hpm/repo.host.json.tmp"
+
+HostFacts :: struct {
+    arch:   string, // nazwy jak w uname -m: x86_64, aarch64, ...
+    libc:   string, // "glibc" albo "musl"
+    kernel: string, // wersja jądra bez sufiksu dystrybucji, np. "6.8.12"; "" = bez filtra
+}
+
+host_facts :: proc() -> HostFacts {
+    facts: HostFacts
+    #partial switch ODIN_ARCH {
+        case .amd64:   facts.arch = "x86_64"
+        case .arm64:   facts.arch = "aarch64"
+        case .i386:    facts.arch = "i686"
+        case .riscv64: facts.arch = "riscv64"
+        case .arm32:   facts.arch = "armv7l"
+        case:          facts.arch = "unknown"
+    }
+    // Pod --root liczy się libc obrazu, nie hosta budującego
+    facts.libc = "glibc"
+    if fd, err := os.open(rooted("/lib"), os.O_RDONLY, 0); err == os.ERROR_NONE {
+        entries, _ := os.read_dir(fd, -1, context.temp_allocator)
+        os.close(fd)
+        for e in entries {
+            if strings.has_prefix(e.name, "ld-musl-") {
+                facts.libc = "musl"
+                break
+            }
+        }
+    }
+    // Jądro obrazu nie jest znane przed jego uruchomieniem, więc pod --root nie filtrujemy po nim
+    if install_root != "" {
+        return facts
+    }
+    if data, ok := os.read_entire_file("/proc/sys/kernel/osrelease", context.temp_allocator); ok {
+        release := strings.trim_space(string(data))
+        if dash := strings.index_byte(release, '-'); dash > 0 {
+            release = release[:dash]
+        }
+        facts.kernel = release
+    }
+    return facts
+}
+
+// Odcisk indeksu hosta: zmiana repo.json albo faktów (np. nowe jądro) go unieważnia
+host_fingerprint :: proc(index_sha: string, facts: HostFacts) -> string {
+    return fmt.tprintf("%s %s %s %s", index_sha, facts.arch, facts.libc, facts.kernel)
+}
+
+// arch i libc: lista wartości rozdzielona przecinkami lub spacjami ("any" pasuje zawsze);
+// kernel: wymaganie wersji jak w zależnościach (">=5.10"). Nieznane klucze są
+// informacyjne i niczego nie wykluczają.
+specs_match :: proc(specs: map[string]string, facts: HostFacts) -> bool {
+    in_list :: proc(list: string, value: string) -> bool {
+        normalized, _ := strings.replace_all(strings.to_lower(list, context.temp_allocator), ",", " ", context.temp_allocator)
+        items := strings.fields(normalized, context.temp_allocator)
+        if len(items) == 0 {
+            return true
+        }
+        for item in items {
+            if item == "any" || item == value {
+                return true
+            }
+        }
+        return false
+    }
+    for key, value in specs {
+        switch strings.to_lower(key, context.temp_allocator) {
+            case "arch":
+                if !in_list(value, facts.arch) { return false }
+            case "libc":
+                if !in_list(value, facts.libc) { return false }
+            case "kernel":
+                req := strings.trim_space(value)
+                if req != "" && facts.kernel != "" && !satisfies(facts.kernel, req) { return false }
+        }
+    }
+    return true
+}
+
+// Usuwa w miejscu wersje niepasujące do hosta; zwraca liczbę usuniętych wersji
+filter_repo_for_host :: proc(repo: ^Repo, facts: HostFacts) -> int {
+    dropped := 0
+    empty: [dynamic]string
+    defer delete(empty)
+    for name, &pkg in repo^ {
+        kept := 0
+        for v in pkg.versions {
+            if specs_match(v.specs, facts) {
+                pkg.versions[kept] = v
+                kept += 1
+            } else {
+                dropped += 1
+            }
+        }
+        resize(&pkg.versions, kept)
+        if kept == 0 {
+            append(&empty, name)
+        }
+    }
+    for name in empty {
+        delete_key(repo, name)
+    }
+    return dropped
+}
+
+// Indeks hosta jest aktualny, gdy plik istnieje i odcisk w meta pasuje
+host_index_current :: proc(allocator: mem.Allocator) -> bool {
+    meta := load_index_meta(allocator)
+    return meta.host != "" && meta.host == host_fingerprint(meta.sha256, host_facts()) && os.exists(HOST_INDEX_PATH)
+}
+
+build_host_index :: proc(allocator: mem.Allocator, meta: ^IndexMeta) -> bool {
+    arena: mem.Dynamic_Arena
+    mem.dynamic_arena_init(&arena, runtime.heap_allocator(), runtime.heap_allocator())
+    defer mem.dynamic_arena_destroy(&arena)
+    arena_alloc := mem.dynamic_arena_allocator(&arena)
+
+    repo, repo_err := load_repo(arena_alloc, true, true)
+    if repo_err != .None {
+        return false
+    }
+    facts := host_facts()
+    dropped := filter_repo_for_host(&repo, facts)
+    data, merr := json.marshal(repo, allocator = arena_alloc)
+    if merr != nil {
+        return false
+    }
+    if !os.write_entire_file(HOST_INDEX_TMP, data) {
+        return false
+    }
+    if os.rename(HOST_INDEX_TMP, HOST_INDEX_PATH) != os.ERROR_NONE {
+        os.remove(HOST_INDEX_TMP)
+        return false
+    }
+    meta.host = strings.clone(host_fingerprint(meta.sha256, facts), allocator)
+    save_index_meta(meta, allocator)
+    log_to_file("INFO", fmt.tprintf("host index (%s/%s, kernel %s): %d packages, %d versions dropped", facts.arch, facts.libc, facts.kernel, len(repo), dropped))
+    return true
+}
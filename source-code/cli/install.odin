@@ -7,6 +7,7 @@ import "core:path/filepath"
 import "core:sys/linux"
 import "core:time"
 import "core:encoding/json"
+import "core:thread"
 
 Manifest :: struct {
     bins:        [dynamic]string,
@@ -77,46 +78,33 @@ makedirs :: proc(path: string) -> bool {
     return code == 0 && err == .None
 }
 
-refresh :: proc(allocator: mem.Allocator) -> Error {
-    log_to_file("INFO", "Refreshing package index")
-    if !makedirs("/usr/lib/HackerOS/hpm") {
-        log_to_file("ERROR", "Failed to create /usr/lib/HackerOS/hpm")
-        return .BackendFailed
-    }
-
-    err := download_file(allocator, REPO_JSON_URL, REPO_JSON_TMP)
-    if err != .None {
-        log_to_file("ERROR", "Download failed for repo.json")
-        return err
+install :: proc(allocator: mem.Allocator, raw_args: []string) -> Error {
+    bundle_path := ""
+    args: [dynamic]string
+    defer delete(args)
+    for i := 0; i < len(raw_args); i += 1 {
+        if raw_args[i] == "--from-bundle" && i + 1 < len(raw_args) {
+            bundle_path = raw_args[i+1]
+            i += 1
+        } else {
+            append(&args, raw_args[i])
+        }
     }
-
-    if os.rename(REPO_JSON_TMP, REPO_JSON_PATH) != os.ERROR_NONE {
-        log_to_file("ERROR", "Failed to rename repo.json.tmp -> repo.json")
-        os.remove(REPO_JSON_TMP)
-        return .BackendFailed
+    if len(args) == 0 {
+        return .InvalidArgs
     }
-
-    fmt.printf("%s✔ Package index refreshed.%s\n", COLOR_GREEN, COLOR_RESET)
-    return .None
-}
-
-install :: proc(allocator: mem.Allocator, args: []string) -> Error {
     lock_err := acquire_lock()
     if lock_err != .None {
         return lock_err
     }
     defer release_lock()
-    log_to_file("INFO", fmt.tprintf("Installing %s", strings.join(args, " ")))
-    repo, repo_err := load_repo(allocator)
-    if repo_err != .None {
-        return repo_err
-    }
-    defer deinit_repo(&repo, allocator)
+    log_to_file("INFO", fmt.tprintf("Installing %s", strings.join(args[:], " ")))
     state, state_err := load_state(allocator)
     if state_err != .None {
         return state_err
     }
     defer delete_state(&state, allocator)
+    graph := load_depgraph(allocator, &state)
     installed, inst_err := get_installed(allocator, &state)
     if inst_err != .None {
         return inst_err
@@ -128,61 +116,129 @@ install :: proc(allocator: mem.Allocator, args: []string) -> Error {
         }
         delete(installed)
     }
+    roots: [dynamic]string
+    defer delete(roots)
+    for spec in args {
+        append(&roots, strings.split(spec, "@", context.temp_allocator)[0])
+    }
+
+    // Zapamiętany plan dla tego samego indeksu, żądania i zbioru zainstalowanych.
+    // Jeśli wszystko z planu już jest zainstalowane, kończymy bez wczytywania repo.
+    cache_key := bundle_path == "" ? resolve_cache_key(allocator, args[:], &installed) : ResolveCacheKey{}
+    plan, cached := load_resolved(allocator, cache_key)
+    defer delete(plan)
+    if cached {
+        satisfied := true
+        for item in plan {
+            if installed[item.pkg] != item.ver {
+                satisfied = false
+                break
+            }
+        }
+        if satisfied {
+            newly_requested := false
+            for pkg in roots {
+                if !graph.requested[pkg] {
+                    graph.requested[strings.clone(pkg, allocator)] = true
+                    newly_requested = true
+                }
+            }
+            if newly_requested {
+                save_depgraph(&graph, allocator)
+            }
+            fmt.printf("%s✔ Nothing to do: %d package(s) already installed.%s\n", COLOR_GREEN, len(plan), COLOR_RESET)
+            return .None
+        }
+        log_to_file("INFO", "install: using cached resolution")
+    }
+
+    // Z paczką offline indeks pochodzi z samej paczki, bez sieci i bez repo.json
+    bundle: Bundle
+    bundle_ptr: ^Bundle = nil
+    repo: Repo
+    if bundle_path != "" {
+        b, bundle_err := open_bundle(allocator, bundle_path)
+        if bundle_err != .None {
+            return bundle_err
+        }
+        bundle = b
+        bundle_ptr = &bundle
+        repo = bundle.index.repo
+    } else {
+        repo_loaded, repo_err := load_repo(allocator)
+        if repo_err != .None {
+            return repo_err
+        }
+        repo = repo_loaded
+    }
+    defer {
+        if bundle_ptr != nil {
+            close_bundle(bundle_ptr, allocator)
+        } else {
+            deinit_repo(&repo, allocator)
+        }
+    }
+    for pkg in roots {
+        graph.requested[strings.clone(pkg, allocator)] = true
+    }
+    if !cached {
+        resolve_err := resolve_install_plan(allocator, &repo, args[:], bundle_ptr != nil, &plan)
+        if resolve_err != .None {
+            return resolve_err
+        }
+        save_resolved(allocator, cache_key, plan[:])
+    }
+
     summary_deps: [dynamic]string
     summary_bins: [dynamic]string
+    used_archives: [dynamic]PkgVer
+    defer delete(used_archives)
+    staged: [dynamic]PkgVer
+    defer delete(staged)
     defer {
         for str in summary_deps { delete(str) }
         delete(summary_deps)
         for str in summary_bins { delete(str) }
         delete(summary_bins)
     }
-    for spec in args {
-        parts := strings.split(spec, "@")
-        defer delete(parts)
-        pkg_name := parts[0]
-        requested_ver := len(parts) > 1 ? parts[1] : ""
-        req := requested_ver != "" ? fmt.tprintf("=%s", requested_ver) : ""
-        chosen: map[string]string
-        order: [dynamic]struct {pkg: string, ver: string}
-        defer {
-            for k, v in chosen {
-                delete(k, allocator)
-                delete(v, allocator)
-            }
-            delete(chosen)
-            for item in order {
-                delete(item.pkg)
-                delete(item.ver)
-            }
-            delete(order)
+    for item in plan {
+        p := item.pkg
+        v := item.ver
+        if inst_ver, ok := installed[p]; ok && satisfies(inst_ver, fmt.tprintf("=%s", v)) {
+            fmt.printf("%s➤ %s@%s already installed.%s\n", COLOR_YELLOW, p, v, COLOR_RESET)
+            continue
         }
-        res_err := resolve_deps_iterative(allocator, &repo, pkg_name, req, &chosen, &order)
-        if res_err != .None {
-            return res_err
+        single_err := install_single(allocator, p, v, &repo, &staged, bundle_ptr)
+        if single_err != .None {
+            return single_err
         }
-        for item in order {
-            p := item.pkg
-            v := item.ver
-            if inst_ver, ok := installed[p]; ok && satisfies(inst_ver, fmt.tprintf("=%s", v)) {
-                fmt.printf("%s➤ %s@%s already installed.%s\n", COLOR_YELLOW, p, v, COLOR_RESET)
-                continue
-            }
-            single_err := install_single(allocator, p, v, &repo, &state)
-            if single_err != .None {
-                return single_err
-            }
-            append(&summary_deps, fmt.tprintf("%s%s@%s%s", COLOR_CYAN, p, v, COLOR_RESET))
-            pkg_path := fmt.tprintf("%s%s/%s", STORE_PATH, p, v)
-            defer delete(pkg_path)
-            manifest, man_err := load_manifest(allocator, pkg_path)
-            if man_err == .None {
-                for bin in manifest.bins {
-                    append(&summary_bins, fmt.tprintf("%s%s%s", COLOR_MAGENTA, bin, COLOR_RESET))
-                }
-                deinit_manifest(&manifest, allocator)
+        append(&summary_deps, fmt.tprintf("%s%s@%s%s", COLOR_CYAN, p, v, COLOR_RESET))
+        append(&used_archives, PkgVer{strings.clone(p, allocator), strings.clone(v, allocator)})
+        pkg_path := fmt.tprintf("%s%s/%s", STORE_PATH, p, v)
+        defer delete(pkg_path)
+        manifest, man_err := load_manifest(allocator, pkg_path)
+        if man_err == .None {
+            for bin in manifest.bins {
+                append(&summary_bins, fmt.tprintf("%s%s%s", COLOR_MAGENTA, bin, COLOR_RESET))
             }
+            deinit_manifest(&manifest, allocator)
         }
     }
+    // Wszystko rozpakowane: jedna bariera, potem przełączenie symlinków i stan
+    if len(staged) > 0 {
+        durable_barrier(STORE_PATH, STATE_PATH)
+    }
+    for item in staged {
+        activate_err := activate_version(allocator, item.pkg, item.ver)
+        if activate_err != .None {
+            save_state(&state, allocator)
+            return activate_err
+        }
+        ver_obj, _ := find_version(repo[item.pkg], item.ver)
+        record_version(allocator, &state, item.pkg, item.ver, ver_obj.sha256 != "" ? ver_obj.sha256 : "none")
+        depgraph_set(&graph, &repo, item.pkg, item.ver)
+        fmt.printf("%s✔ Installed %s%s@%s%s%s\n", COLOR_GREEN, COLOR_CYAN, item.pkg, item.ver, COLOR_RESET, COLOR_RESET)
+    }
     if len(summary_deps) > 0 {
         fmt.printf("%sInstalled dependencies:%s\n", COLOR_BLUE, COLOR_RESET)
         for d in summary_deps { fmt.printf("  - %s\n", d) }
@@ -195,59 +251,141 @@ install :: proc(allocator: mem.Allocator, args: []string) -> Error {
     if err_save != .None {
         return err_save
     }
+    save_depgraph(&graph, allocator)
+    if len(summary_deps) > 0 {
+        if bundle_ptr == nil {
+            cache_after_transaction(allocator, &state, used_archives[:])
+            // Następne identyczne wywołanie trafi już w nowy zbiór zainstalowanych
+            if after, aerr := get_installed(allocator, &state); aerr == .None {
+                save_resolved(allocator, resolve_cache_key(allocator, args[:], &after), plan[:])
+                delete(after)
+            }
+        }
+        return commit_generation(allocator, &state)
+    }
+    return .None
+}
+
+// Pełny plan instalacji dla wszystkich żądań: domknięcia w kolejności
+// instalacji, bez powtórzeń. Domyślne żądania biorą gotowe domknięcie z refresh;
+// jawne wersje i paczki offline przechodzą przez solver. Solver nie patrzy na
+// zainstalowane ani przypięte wersje, więc domknięcie zawsze równa się jego wynikowi.
+resolve_install_plan :: proc(allocator: mem.Allocator, repo: ^Repo, specs: []string, from_bundle: bool, plan: ^[dynamic]PkgVer) -> Error {
+    seen := make(map[string]bool, allocator)
+    defer delete(seen)
+    add :: proc(plan: ^[dynamic]PkgVer, seen: ^map[string]bool, pkg: string, ver: string, allocator: mem.Allocator) {
+        key := fmt.aprintf("%s@%s", pkg, ver, allocator = allocator)
+        if seen^[key] {
+            return
+        }
+        seen^[key] = true
+        append(plan, PkgVer{strings.clone(pkg, allocator), strings.clone(ver, allocator)})
+    }
+    for spec in specs {
+        parts := strings.split(spec, "@")
+        defer delete(parts)
+        pkg_name := parts[0]
+        requested_ver := len(parts) > 1 ? parts[1] : ""
+        if requested_ver == "" && !from_bundle {
+            if items, size, ok := lookup_closure(allocator, pkg_name); ok {
+                count := len(items)
+                for item in items {
+                    add(plan, &seen, item.pkg, item.ver, allocator)
+                }
+                delete(items)
+                if size > 0 {
+                    fmt.printf("%s➤ %s: %d package(s), %s to download at most.%s\n", COLOR_YELLOW, pkg_name, count, format_bytes(size), COLOR_RESET)
+                }
+                continue
+            }
+        }
+        req := requested_ver != "" ? fmt.tprintf("=%s", requested_ver) : ""
+        chosen: map[string]string
+        order: [dynamic]struct {pkg: string, ver: string}
+        defer {
+            delete(chosen)
+            delete(order)
+        }
+        res_err := resolve_deps_iterative(allocator, repo, pkg_name, req, &chosen, &order)
+        if res_err != .None {
+            return res_err
+        }
+        for item in order {
+            add(plan, &seen, item.pkg, item.ver, allocator)
+        }
+    }
     return .None
 }
 
-install_single :: proc(allocator: mem.Allocator, package_name: string, version: string, repo: ^Repo, state: ^StatePackages) -> Error {
+// Pobiera i rozpakowuje jedną wersję obok istniejących; aktywacja odbywa się
+// dopiero po barierze trwałości w install, dla wszystkich naraz
+install_single :: proc(allocator: mem.Allocator, package_name: string, version: string, repo: ^Repo, staged: ^[dynamic]PkgVer, bundle: ^Bundle = nil) -> Error {
     log_to_file("INFO", fmt.tprintf("Installing single %s@%s", package_name, version))
     pkg, ok := repo^[package_name]
     if !ok {
         return .PackageNotFound
     }
-    ver_obj: struct {version: string, url: string, sha256: string, deps: map[string]string}
-    found := false
-    for v in pkg.versions {
-        if v.version == version {
-            ver_obj = v
-            found = true
-            break
-        }
-    }
+    ver_obj, found := find_version(pkg, version)
     if !found {
         log_to_file("ERROR", fmt.tprintf("Version %s not found for %s", version, package_name))
         return .VersionNotFound
     }
-    pkg_url      := ver_obj.url
-    expected_sha := ver_obj.sha256
 
-    // pkg_path     = finalna ścieżka: store/test/0.1
-    // temp_extract = katalog do rozpakowania tarballa: store/test/0.1.tmp
-    // Backend dostaje pkg_path i sam sobie dokłada .tmp wewnętrznie,
-    // pracuje na pkg_path.tmp, a na końcu robi rename(pkg_path.tmp -> pkg_path)
     pkg_path := fmt.tprintf("%s%s/%s", STORE_PATH, package_name, version)
     defer delete(pkg_path)
-
-    current_link := fmt.tprintf("%s%s/current", STORE_PATH, package_name)
-    defer delete(current_link)
-
     if os.exists(pkg_path) {
         fmt.printf("%s✔ Already installed %s%s@%s%s%s\n", COLOR_GREEN, COLOR_CYAN, package_name, version, COLOR_RESET, COLOR_RESET)
         return .None
     }
 
+    if bundle == nil {
+        fetch_err := fetch_archive(allocator, package_name, version, ver_obj.url, archive_digest(ver_obj), size = ver_obj.size)
+        if fetch_err != .None {
+            return fetch_err
+        }
+    }
+    checksum := archive_digest(ver_obj)
+    if checksum == "" {
+        checksum = "none"
+    }
+    stage_err := stage_version(allocator, package_name, version, checksum, bundle)
+    if stage_err != .None {
+        return stage_err
+    }
+    append(staged, PkgVer{strings.clone(package_name, allocator), strings.clone(version, allocator)})
+    return .None
+}
+
+cache_archive_path :: proc(package_name: string, version: string) -> string {
+    return fmt.tprintf("%s%s-%s.hpm", CACHE_PATH, package_name, version)
+}
+
+// Zapewnia, że w CACHE_PATH leży zweryfikowane archiwum pkg@ver.
+// size to rozmiar z indeksu (0 = nieznany); od niego zależy pobieranie segmentami.
+fetch_archive :: proc(allocator: mem.Allocator, package_name: string, version: string, url: string, expected_sha: string, quiet: bool = false, size: i64 = 0) -> Error {
     // Upewnij się że katalog cache istnieje
     if !makedirs(CACHE_PATH) {
         log_to_file("ERROR", fmt.tprintf("Failed to create cache dir: %s", CACHE_PATH))
         return .BackendFailed
     }
 
-    cache_archive := fmt.tprintf("%s%s-%s.hpm", CACHE_PATH, package_name, version)
-    defer delete(cache_archive)
+    cache_archive := cache_archive_path(package_name, version)
+    streamed_sha: string
 
     if os.exists(cache_archive) {
-        fmt.printf("%sUsing cached archive for %s@%s%s\n", COLOR_YELLOW, package_name, version, COLOR_RESET)
+        if !quiet {
+            fmt.printf("%sUsing cached archive for %s@%s%s\n", COLOR_YELLOW, package_name, version, COLOR_RESET)
+        }
+        if cache_memo_matches(allocator, package_name, version, expected_sha) {
+            log_to_file("INFO", fmt.tprintf("%s@%s: cached archive unchanged since verification, skipping rehash", package_name, version))
+            return .None
+        }
+    } else if algo, hex := split_digest(expected_sha); algo == DIGEST_SHA256 && fetch_from_peers(allocator, hex, cache_archive, quiet) {
+        // fetch_from_peers sprawdził już sha256 — bez ponownego haszowania do
+        // dowiązania bloba, żeby ten host mógł podać archiwum dalej
+        streamed_sha = strings.clone(hex, allocator)
     } else {
-        down_err := download_file(allocator, pkg_url, cache_archive)
+        down_err := download_file(allocator, url, cache_archive, quiet, &streamed_sha, size)
         if down_err != .None {
             log_to_file("ERROR", "Download failed")
             return down_err
@@ -255,14 +393,83 @@ install_single :: proc(allocator: mem.Allocator, package_name: string, version:
     }
 
     if expected_sha != "" {
-        computed_sha, sha_err := compute_sha256_stream(allocator, cache_archive)
-        defer delete(computed_sha)
-        if sha_err != .None || computed_sha != expected_sha {
-            log_to_file("ERROR", "SHA256 mismatch")
+        // Pobranie segmentowe liczy sha256 w trakcie; inaczej czytamy plik jeszcze raz
+        algo, hex := split_digest(expected_sha)
+        verified := algo == DIGEST_SHA256 && streamed_sha != "" ? streamed_sha == hex : verify_file_digest(allocator, cache_archive, expected_sha)
+        delete(streamed_sha)
+        if !verified {
+            log_to_file("ERROR", fmt.tprintf("%s mismatch for %s@%s", algo, package_name, version))
             os.remove(cache_archive)
             return .ChecksumMismatch
         }
+        // Peery adresują archiwa po sha256
+        if algo == DIGEST_SHA256 {
+            link_cache_blob(cache_archive, hex)
+        }
+        cache_memo_record(allocator, package_name, version, expected_sha)
     }
+    return .None
+}
+
+FetchJob :: struct {
+    pkg:     string,
+    version: string,
+    url:     string,
+    sha256:  string, // oczekiwany skrót, jak z archive_digest
+    size:    i64,    // rozmiar z indeksu, 0 = nieznany
+    err:     Error,
+}
+
+MAX_PARALLEL_FETCHES :: 4
+
+fetch_worker :: proc(t: ^thread.Thread) {
+    jobs := (^[]FetchJob)(t.data)^
+    for i := t.user_index; i < len(jobs); i += MAX_PARALLEL_FETCHES {
+        job := &jobs[i]
+        job.err = fetch_archive(context.allocator, job.pkg, job.version, job.url, job.sha256, true, job.size)
+    }
+}
+
+// Pobiera i weryfikuje archiwa równolegle; nic nie instaluje
+prefetch_archives :: proc(jobs: []FetchJob) -> Error {
+    if len(jobs) == 0 {
+        return .None
+    }
+    fmt.printf("%s↓ Fetching %d archive(s)...%s\n", COLOR_YELLOW, len(jobs), COLOR_RESET)
+    jobs_ref := jobs
+    threads: [dynamic]^thread.Thread
+    defer delete(threads)
+    for i in 0..<min(MAX_PARALLEL_FETCHES, len(jobs)) {
+        t := thread.create(fetch_worker)
+        t.data = rawptr(&jobs_ref)
+        t.user_index = i
+        thread.start(t)
+        append(&threads, t)
+    }
+    for t in threads {
+        thread.join(t)
+        thread.destroy(t)
+    }
+    for job in jobs {
+        if job.err != .None {
+            fmt.printf("%s✖ Failed to fetch %s@%s.%s\n", COLOR_RED, job.pkg, job.version, COLOR_RESET)
+            return job.err
+        }
+    }
+    fmt.printf("%s✔ All archives fetched and verified.%s\n", COLOR_GREEN, COLOR_RESET)
+    return .None
+}
+
+// Rozpakowuje archiwum z cache obok istniejących wersji (store/pkg/ver),
+// nie ruszając symlinku current ani wrapperów w /usr/bin
+stage_version :: proc(allocator: mem.Allocator, package_name: string, version: string, checksum: string, bundle: ^Bundle = nil) -> Error {
+    // pkg_path     = finalna ścieżka: store/test/0.1
+    // temp_extract = katalog do rozpakowania tarballa: store/test/0.1.tmp
+    // Backend dostaje pkg_path i sam sobie dokłada .tmp wewnętrznie,
+    // pracuje na pkg_path.tmp, a na końcu robi rename(pkg_path.tmp -> pkg_path)
+    pkg_path := fmt.tprintf("%s%s/%s", STORE_PATH, package_name, version)
+    defer delete(pkg_path)
+    cache_archive := cache_archive_path(package_name, version)
 
     // Utwórz store/package_name/ rekurencyjnie (mkdir -p)
     // MUSI istnieć zanim powstanie store/package_name/version.tmp
@@ -280,7 +487,7 @@ install_single :: proc(allocator: mem.Allocator, package_name: string, version:
     defer delete(temp_extract)
 
     if os.exists(temp_extract) {
-        os.remove_directory(temp_extract)
+        remove_tree(temp_extract)
     }
     if !makedirs(temp_extract) {
         log_to_file("ERROR", fmt.tprintf("Failed to create temp extract dir: %s", temp_extract))
@@ -291,79 +498,89 @@ install_single :: proc(allocator: mem.Allocator, package_name: string, version:
     defer stop_spinner(done, t)
 
     // Rozpakuj tarball do temp_extract (store/test/0.1.tmp)
-    unpack_args := []string{"tar", "-I", "zstd", "-xf", cache_archive, "-C", temp_extract}
-    code, run_err := run_command(unpack_args[:])
-    if code != 0 || run_err != .None {
-        log_to_file("ERROR", "Unpack failed")
-        os.remove_directory(temp_extract)
-        return .UnpackFailed
+    if bundle != nil {
+        unpack_err := extract_from_bundle(bundle, package_name, version, temp_extract)
+        if unpack_err != .None {
+            log_to_file("ERROR", "Unpack from bundle failed")
+            remove_tree(temp_extract)
+            return unpack_err
+        }
+    } else {
+        unpack_args := []string{"tar", "-I", "zstd", "-xf", cache_archive, "-C", temp_extract}
+        code, run_err := run_command(unpack_args[:])
+        if code != 0 || run_err != .None {
+            log_to_file("ERROR", "Unpack failed")
+            remove_tree(temp_extract)
+            return .UnpackFailed
+        }
     }
 
-    checksum := expected_sha != "" ? expected_sha : "none"
-
     // KLUCZOWA POPRAWKA:
     // Przekazujemy pkg_path ("store/test/0.1") — NIE temp_extract ("store/test/0.1.tmp")
     // Backend sam robi: let tmp_path = format!("{}.tmp", path)
     // Więc znajdzie store/test/0.1.tmp (które właśnie rozpakowaliśmy),
     // wykona operacje instalacji, i na końcu rename(0.1.tmp -> 0.1)
-    backend_args := []string{BACKEND_PATH, "install", package_name, version, pkg_path, checksum}
-    code, run_err = run_command(backend_args[:])
+    backend_args := backend_command("install", package_name, version, pkg_path, checksum, durability_name(durability))
+    code, run_err := run_command(backend_args[:])
     if code != 0 || run_err != .None {
         log_to_file("ERROR", "Backend install failed")
-        os.remove_directory(temp_extract)
+        remove_tree(temp_extract)
         return .BackendFailed
     }
 
     // Backend już wykonał rename(0.1.tmp -> 0.1) — nie robimy tu nic więcej
+    return .None
+}
+
+// Przełącza store/pkg/current na podaną wersję (atomowo, przez rename).
+// Binarki w /usr/bin zaczynają jej używać dopiero po commit_generation.
+activate_version :: proc(allocator: mem.Allocator, package_name: string, version: string) -> Error {
+    current_link := fmt.tprintf("%s%s/current", STORE_PATH, package_name)
+    defer delete(current_link)
 
     // Utwórz symlink: store/test/current -> 0.1
-    symlink_dir := filepath.dir(current_link)
-    if !makedirs(symlink_dir) {
-        log_to_file("ERROR", fmt.tprintf("Failed to create symlink dir: %s", symlink_dir))
-        return .BackendFailed
-    }
-    if os.exists(current_link) {
-        os.remove(current_link)
-    }
-    symlink_err := linux.symlink(
-        strings.clone_to_cstring(version, context.temp_allocator),
-        strings.clone_to_cstring(current_link, context.temp_allocator),
-    )
-    if symlink_err != .NONE {
+    if !atomic_symlink(version, current_link) {
         log_to_file("ERROR", fmt.tprintf("Failed to create symlink %s -> %s", current_link, version))
         return .SymlinkFailed
     }
+    if durability == .Strict {
+        durable_rename_done(fmt.tprintf("%s%s", STORE_PATH, package_name))
+    }
+    return .None
+}
 
-    manifest, man_err := load_manifest(allocator, pkg_path)
-    if man_err != .None {
-        log_to_file("ERROR", fmt.tprintf("Failed to load manifest from %s", pkg_path))
-        return man_err
-    }
-    defer deinit_manifest(&manifest, allocator)
-
-    for bin in manifest.bins {
-        wrapper_path := fmt.tprintf("/usr/bin/%s", bin)
-        defer delete(wrapper_path)
-        wrapper_content := fmt.tprintf("#!/bin/sh\nexec %s run %s %s \"$@\"\n", BACKEND_PATH, package_name, bin)
-        defer delete(wrapper_content)
-        os.write_entire_file(wrapper_path, transmute([]u8)wrapper_content)
-        if linux.chmod(
-            strings.clone_to_cstring(wrapper_path, context.temp_allocator),
-            {.IRUSR, .IWUSR, .IXUSR, .IRGRP, .IXGRP, .IROTH, .IXOTH},
-        ) != .NONE {
-            log_to_file("ERROR", fmt.tprintf("Failed to chmod wrapper: %s", wrapper_path))
-            return .ChmodFailed
-        }
+write_wrapper :: proc(package_name: string, bin: string, dir: string) -> Error {
+    wrapper_path := fmt.tprintf("%s/%s", dir, bin)
+    defer delete(wrapper_path)
+    wrapper_tmp := fmt.tprintf("%s/.%s.hpm-tmp", dir, bin)
+    defer delete(wrapper_tmp)
+    wrapper_content := fmt.tprintf("#!/bin/sh\nexec %s run %s %s \"$@\"\n", BACKEND_PATH, package_name, bin)
+    defer delete(wrapper_content)
+    os.write_entire_file(wrapper_tmp, transmute([]u8)wrapper_content)
+    if linux.chmod(
+        strings.clone_to_cstring(wrapper_tmp, context.temp_allocator),
+        {.IRUSR, .IWUSR, .IXUSR, .IRGRP, .IXGRP, .IROTH, .IXOTH},
+    ) != .NONE {
+        log_to_file("ERROR", fmt.tprintf("Failed to chmod wrapper: %s", wrapper_path))
+        os.remove(wrapper_tmp)
+        return .ChmodFailed
+    }
+    if os.rename(wrapper_tmp, wrapper_path) != os.ERROR_NONE {
+        log_to_file("ERROR", fmt.tprintf("Failed to install wrapper: %s", wrapper_path))
+        os.remove(wrapper_tmp)
+        return .SymlinkFailed
     }
+    return .None
+}
 
-    if _, ok2 := state^[package_name]; !ok2 {
+record_version :: proc(allocator: mem.Allocator, state: ^StatePackages, package_name: string, version: string, checksum: string) {
+    if _, ok := state^[package_name]; !ok {
         state^[package_name] = make(map[string]VersionInfo, allocator)
     }
     vers := state^[package_name]
-    vers[version] = VersionInfo{checksum = checksum, date = time.now(), pinned = false}
-
-    fmt.printf("%s✔ Installed %s%s@%s%s%s\n", COLOR_GREEN, COLOR_CYAN, package_name, version, COLOR_RESET, COLOR_RESET)
-    return .None
+    algo, hex := split_digest(checksum)
+    vers[version] = VersionInfo{checksum = hex, digest_algo = strings.clone(algo, allocator), date = time.now(), pinned = false}
+    state^[package_name] = vers
 }
 
 verify :: proc(allocator: mem.Allocator, pkg_name: string) -> Error {
@@ -390,7 +607,7 @@ verify :: proc(allocator: mem.Allocator, pkg_name: string) -> Error {
     }
     pkg_path := fmt.tprintf("%s%s/%s", STORE_PATH, pkg_name, ver)
     defer delete(pkg_path)
-    backend_args := []string{BACKEND_PATH, "verify", pkg_name, ver, pkg_path, info.checksum}
+    backend_args := []string{BACKEND_PATH, "verify", pkg_name, ver, pkg_path, tag_digest(info.digest_algo, info.checksum)}
     code, run_err := run_command(backend_args[:])
     if code != 0 || run_err != .None {
         fmt.printf("%sVerification failed for %s@%s.%s\n", COLOR_RED, pkg_name, ver, COLOR_RESET)
@@ -0,0 +1,224 @@
+package hpm
+
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:encoding/json"
+
+DEFAULT_LOCKFILE :: "hpm.lock"
+
+LockedPackage :: struct {
+    version: string,
+    url:     string,
+    sha256:  string, // skrót archiwum; inne algorytmy niż sha256 z prefiksem, np. "blake3:..."
+}
+
+Lockfile :: struct {
+    packages: map[string]LockedPackage,
+}
+
+// hpm lock [plik] — zapisuje dokładny zestaw aktywnych wersji z URL i sha256
+lock :: proc(allocator: mem.Allocator, path: string) -> Error {
+    state, state_err := load_state(allocator)
+    if state_err != .None {
+        return state_err
+    }
+    defer delete_state(&state, allocator)
+    installed, inst_err := get_installed(allocator, &state)
+    if inst_err != .None {
+        return inst_err
+    }
+    defer delete(installed)
+    repo, repo_err := load_repo(allocator)
+    if repo_err != .None {
+        return repo_err
+    }
+    defer deinit_repo(&repo, allocator)
+
+    lf := Lockfile{packages = make(map[string]LockedPackage, allocator)}
+    for pkg, ver in installed {
+        locked := LockedPackage{version = ver}
+        if ver_obj, ok := find_version(repo[pkg], ver); ok {
+            locked.url = ver_obj.url
+            locked.sha256 = archive_digest(ver_obj)
+        } else {
+            // Wersja zniknęła z indeksu — blokujemy ją, ale apply nie pobierze jej ponownie
+            log_to_file("WARN", fmt.tprintf("lock: %s@%s is not in the package index", pkg, ver))
+            if vinfo, vok := state[pkg][ver]; vok && vinfo.checksum != "none" {
+                locked.sha256 = tag_digest(vinfo.digest_algo, vinfo.checksum)
+            }
+        }
+        lf.packages[pkg] = locked
+    }
+    data, merr := json.marshal(lf, {pretty = true}, allocator = allocator)
+    if merr != nil {
+        return .LockfileFailed
+    }
+    defer delete(data)
+    tmp_path := fmt.tprintf("%s.tmp", path)
+    if !os.write_entire_file(tmp_path, data) || os.rename(tmp_path, path) != os.ERROR_NONE {
+        os.remove(tmp_path)
+        return .LockfileFailed
+    }
+    fmt.printf("%s✔ Locked %d package(s) to %s.%s\n", COLOR_GREEN, len(lf.packages), path, COLOR_RESET)
+    return .None
+}
+
+// hpm apply [plik] — doprowadza system do stanu z lockfile'a bez rozwiązywania
+// zależności: instaluje brakujące wersje, przełącza current i usuwa nadmiarowe.
+apply :: proc(allocator: mem.Allocator, path: string) -> Error {
+    data, ok := os.read_entire_file(path, allocator)
+    if !ok {
+        return .LockfileFailed
+    }
+    defer delete(data)
+    lf: Lockfile
+    if json.unmarshal(data, &lf, allocator = allocator) != nil {
+        return .LockfileFailed
+    }
+    defer delete(lf.packages)
+
+    lock_err := acquire_lock()
+    if lock_err != .None {
+        return lock_err
+    }
+    defer release_lock()
+    state, state_err := load_state(allocator)
+    if state_err != .None {
+        return state_err
+    }
+    defer delete_state(&state, allocator)
+    installed, inst_err := get_installed(allocator, &state)
+    if inst_err != .None {
+        return inst_err
+    }
+    defer delete(installed)
+    to_install: [dynamic]FetchJob
+    to_switch: [dynamic]PkgVer
+    to_remove: [dynamic]string
+    defer {
+        delete(to_install)
+        delete(to_switch)
+        delete(to_remove)
+    }
+    // Ta sama wersja z innym skrótem to ponownie opublikowane archiwum;
+    // nie nadpisujemy po cichu zainstalowanej treści, tylko zgłaszamy rozjazd
+    mismatched := 0
+    for pkg, locked in lf.packages {
+        if vinfo, ok := state[pkg][locked.version]; ok && locked_digest_differs(locked.sha256, vinfo) {
+            fmt.printf("%s✖ %s@%s: checksum in %s differs from the installed one (%s).%s\n", COLOR_RED, pkg, locked.version, path, tag_digest(vinfo.digest_algo, vinfo.checksum), COLOR_RESET)
+            mismatched += 1
+        }
+    }
+    if mismatched > 0 {
+        log_to_file("ERROR", fmt.tprintf("apply %s: %d locked checksum(s) differ from installed versions", path, mismatched))
+        return .LockfileFailed
+    }
+    for pkg, locked in lf.packages {
+        if installed[pkg] == locked.version {
+            continue
+        }
+        // Usunięta wersja może jeszcze leżeć w store dla rollbacku, ale bez wpisu w stanie
+        // trzeba ją zainstalować od nowa
+        _, recorded := state[pkg][locked.version]
+        if recorded && os.exists(fmt.tprintf("%s%s/%s", STORE_PATH, pkg, locked.version)) {
+            append(&to_switch, PkgVer{pkg, locked.version})
+        } else {
+            if locked.url == "" {
+                fmt.printf("%s✖ %s@%s has no URL in %s.%s\n", COLOR_RED, pkg, locked.version, path, COLOR_RESET)
+                return .LockfileFailed
+            }
+            append(&to_install, FetchJob{pkg = pkg, version = locked.version, url = locked.url, sha256 = locked.sha256})
+        }
+    }
+    for pkg in installed {
+        if _, locked := lf.packages[pkg]; !locked {
+            append(&to_remove, pkg)
+        }
+    }
+    if len(to_install) == 0 && len(to_switch) == 0 && len(to_remove) == 0 {
+        fmt.printf("%s✔ Already converged to %s.%s\n", COLOR_GREEN, path, COLOR_RESET)
+        return .None
+    }
+    log_to_file("INFO", fmt.tprintf("apply %s: %d install, %d switch, %d remove", path, len(to_install), len(to_switch), len(to_remove)))
+    // Graf i indeks dopiero, gdy jest coś do zrobienia: zbieżny host kończy na samym stanie
+    graph := load_depgraph(allocator, &state)
+    // Indeks tylko do krawędzi grafu zależności; bez niego apply i tak działa
+    repo, repo_err := load_repo(allocator, true)
+    defer if repo_err == .None {
+        deinit_repo(&repo, allocator)
+    }
+    for pkg in lf.packages {
+        graph.requested[strings.clone(pkg, allocator)] = true
+    }
+
+    fetch_err := prefetch_archives(to_install[:])
+    if fetch_err != .None {
+        return fetch_err
+    }
+    for job in to_install {
+        checksum := job.sha256 != "" ? job.sha256 : "none"
+        stage_err := stage_version(allocator, job.pkg, job.version, checksum)
+        if stage_err != .None {
+            return stage_err
+        }
+    }
+    durable_barrier(STORE_PATH, STATE_PATH)
+    used_archives: [dynamic]PkgVer
+    defer delete(used_archives)
+    for job in to_install {
+        if err := activate_version(allocator, job.pkg, job.version); err != .None {
+            save_state(&state, allocator)
+            return err
+        }
+        record_version(allocator, &state, job.pkg, job.version, job.sha256 != "" ? job.sha256 : "none")
+        depgraph_set(&graph, &repo, job.pkg, job.version)
+        append(&used_archives, PkgVer{job.pkg, job.version})
+        fmt.printf("%s✔ Installed %s%s@%s%s%s\n", COLOR_GREEN, COLOR_CYAN, job.pkg, job.version, COLOR_RESET, COLOR_RESET)
+    }
+    for item in to_switch {
+        if err := activate_version(allocator, item.pkg, item.ver); err != .None {
+            save_state(&state, allocator)
+            return err
+        }
+        depgraph_set(&graph, &repo, item.pkg, item.ver)
+        fmt.printf("%s✔ Switched %s%s%s to %s%s%s.%s\n", COLOR_GREEN, COLOR_CYAN, item.pkg, COLOR_RESET, COLOR_CYAN, item.ver, COLOR_RESET, COLOR_RESET)
+    }
+    for pkg in to_remove {
+        if err := remove_all_versions(allocator, &state, pkg); err != .None {
+            save_state(&state, allocator)
+            return err
+        }
+        depgraph_drop(&graph, pkg)
+        fmt.printf("%s✔ %s removed.%s\n", COLOR_GREEN, pkg, COLOR_RESET)
+    }
+    save_err := save_state(&state, allocator)
+    if save_err != .None {
+        return save_err
+    }
+    save_depgraph(&graph, allocator)
+    cache_after_transaction(allocator, &state, used_archives[:])
+    gen_err := commit_generation(allocator, &state)
+    if gen_err == .None && len(to_remove) > 0 {
+        collect_unreferenced(allocator, &state)
+    }
+    return gen_err
+}
+
+// Skróty w różnych algorytmach są nieporównywalne; brak skrótu po którejś stronie też nie jest rozjazdem
+locked_digest_differs :: proc(locked: string, vinfo: VersionInfo) -> bool {
+    if locked == "" || vinfo.checksum == "" || vinfo.checksum == "none" {
+        return false
+    }
+    algo, hex := split_digest(locked)
+    have_algo := vinfo.digest_algo != "" ? vinfo.digest_algo : DIGEST_SHA256
+    return algo == have_algo && !strings.equal_fold(hex, vinfo.checksum)
+}
+
+lockfile_arg :: proc(args: []string) -> string {
+    if len(args) > 0 && !strings.has_prefix(args[0], "-") {
+        return args[0]
+    }
+    return DEFAULT_LOCKFILE
+}
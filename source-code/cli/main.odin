@@ -14,18 +14,18 @@ import "core:thread"
 import "core:io"
 
 VERSION :: "0.6"
-STORE_PATH :: "/usr/lib/HackerOS/hpm/store/"
+STORE_PATH := "/usr/lib/HackerOS/hpm/store/"
 BACKEND_PATH :: "/usr/lib/HackerOS/hpm/backend"
 REPO_JSON_URL :: "https://raw.githubusercontent.com/HackerOS-Linux-System/Hacker-Package-Manager/main/repo/repo.json"
 VERSION_URL :: "https://raw.githubusercontent.com/HackerOS-Linux-System/Hacker-Package-Manager/main/version.hacker"
 LOCAL_VERSION_FILE :: "/usr/lib/HackerOS/hpm/version.json"
 RELEASES_BASE :: "https://github.com/HackerOS-Linux-System/Hacker-Package-Manager/releases/download/v"
-REPO_JSON_PATH :: "/usr/lib/HackerOS/hpm/repo.json"
-REPO_JSON_TMP  :: "/usr/lib/HackerOS/hpm/repo.json.tmp"
-STATE_PATH :: "/var/lib/hpm/state.json"
-STATE_TMP_PATH :: "/var/lib/hpm/state.json.tmp"
-LOCK_PATH :: "/var/lib/hpm/lock"
-LOG_PATH :: "/var/log/hpm.log"
+REPO_JSON_PATH := "/usr/lib/HackerOS/hpm/repo.json"
+REPO_JSON_TMP  := "/usr/lib/HackerOS/hpm/repo.json.tmp"
+STATE_PATH := "/var/lib/hpm/state.json"
+STATE_TMP_PATH := "/var/lib/hpm/state.json.tmp"
+LOCK_PATH := "/var/lib/hpm/lock"
+LOG_PATH := "/var/log/hpm.log"
 CACHE_PATH :: "/var/cache/hpm/"
 
 // Kolory ANSI
@@ -61,6 +61,11 @@ Error :: enum {
     ListFailed,
     CleanFailed,
     VerifyFailed,
+    GenerationFailed,
+    GenerationNotFound,
+    CacheFailed,
+    BundleFailed,
+    LockfileFailed,
 }
 
 main :: proc() {
@@ -71,14 +76,33 @@ main :: proc() {
     allocator := mem.arena_allocator(&arena)
     context.allocator = allocator
 
-    // Upewnij się że katalogi systemowe istnieją
-    os.make_directory("/usr/lib/HackerOS", 0o755)
-    os.make_directory("/usr/lib/HackerOS/hpm", 0o755)
-    os.make_directory(STORE_PATH, 0o755)
-    os.make_directory("/var/lib/hpm", 0o755)
-    os.make_directory(CACHE_PATH, 0o755)
+    root_args, root, root_ok := take_root_flag(os.args[1:])
+    if !root_ok {
+        print_error(.InvalidArgs)
+        os.exit(1)
+    }
+    relocate_paths(root)
+
+    // Upewnij się że katalogi systemowe istnieją (świeży korzeń obrazu bywa pusty)
+    makedirs(rooted("/usr/lib/HackerOS/hpm"))
+    makedirs(STORE_PATH)
+    makedirs(rooted("/var/lib/hpm"))
+    makedirs(CACHE_PATH)
+    makedirs(PROFILES_PATH)
+    if install_root != "" {
+        makedirs(rooted("/var/log"))
+        makedirs(BIN_PATH)
+    }
 
-    args := os.args[1:]
+    config = load_config(allocator)
+    if d, ok := parse_durability(config.durability); ok {
+        durability = d
+    }
+    args, flags_ok := take_global_flags(root_args)
+    if !flags_ok {
+        print_error(.InvalidArgs)
+        os.exit(1)
+    }
     if len(args) < 1 {
         print_help()
         return
@@ -98,7 +122,7 @@ main :: proc() {
             if len(args) < 2 {
                 err = .InvalidArgs
             } else {
-                err = remove(allocator, args[1])
+                err = remove(allocator, args[1], false, len(args) > 2 && args[2] == "--force")
             }
         case "update":
             err = update(allocator)
@@ -159,6 +183,42 @@ main :: proc() {
             } else {
                 err = verify(allocator, args[1])
             }
+        case "rollback":
+            err = rollback(allocator, len(args) > 1 ? args[1] : "")
+        case "generations":
+            err = generations(allocator)
+        case "lock":
+            err = lock(allocator, lockfile_arg(args[1:]))
+        case "apply":
+            err = apply(allocator, lockfile_arg(args[1:]))
+        case "bundle":
+            if len(args) < 4 {
+                err = .InvalidArgs
+            } else {
+                err = make_bundle(allocator, args[1:])
+            }
+        case "cache":
+            err = cache_command(allocator, args[1:])
+        case "cache-serve":
+            err = cache_serve(allocator, args[1:])
+        case "prefetch":
+            err = prefetch(allocator, args[1:])
+        case "gc":
+            err = gc(allocator, args[1:])
+        case "why":
+            if len(args) < 2 {
+                err = .InvalidArgs
+            } else {
+                err = why(allocator, args[1])
+            }
+        case "autoremove":
+            err = autoremove(allocator, args[1:])
+        case "query":
+            err = query(allocator, args[1:])
+        case "mirrors":
+            err = mirrors_command(allocator)
+        case "bench":
+            err = bench(allocator, args[1:])
         case "deps":
             if len(args) < 2 {
                 err = .InvalidArgs
@@ -169,6 +229,7 @@ main :: proc() {
             print_help()
             return
     }
+    cache_memo_flush(allocator)
     if err != .None {
         print_error(err)
         os.exit(1)
@@ -181,13 +242,19 @@ print_help :: proc() {
     fmt.println("Commands:")
     fmt.printf("  %srefresh%s               Refresh package index\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %sinstall%s <pkg>[@ver]   Install package (with optional version)\n", COLOR_CYAN, COLOR_RESET)
-    fmt.printf("  %sremove%s  <pkg>[@ver]   Remove package (with optional version)\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %sinstall%s --from-bundle <file> <pkg>...  Install offline from a bundle\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %sremove%s  <pkg>[@ver] [--force]  Remove package (refuses if others depend on it)\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %swhy%s     <pkg>         Show which requested packages need it\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %sautoremove%s [-y]       Remove dependencies no requested package needs\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %supdate%s                Update all installed packages\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %sprefetch%s [--limit-rate R] [--no-refresh]  Download pending updates in the background\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %sswitch%s  <pkg> <ver>   Switch to specific version\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %supgrade%s               Upgrade HPM itself\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %srun%s     <pkg>[@ver] <bin>  Run tool from package\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %srun%s     --record-readahead <pkg> <bin>  Run and record a readahead profile for cold starts\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %sbuild%s   <name>        Build .hpm package from current directory\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %ssearch%s  <query>       Search packages by name/description\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %squery%s   <field>[!]=<value>...  Find packages by depends, author, license or bin\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %sinfo%s    <pkg>         Show package info\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %slist%s                  List installed packages\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %sclean%s                 Clean cache\n", COLOR_CYAN, COLOR_RESET)
@@ -196,6 +263,20 @@ print_help :: proc() {
     fmt.printf("  %soutdated%s              List outdated packages\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %sverify%s  <pkg>         Verify package checksum\n", COLOR_CYAN, COLOR_RESET)
     fmt.printf("  %sdeps%s    <pkg>         Show dependency tree\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %srollback%s [gen]        Activate previous (or given) generation\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %sgenerations%s           List profile generations\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %slock%s    [file]        Write hpm.lock with exact installed versions\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %sapply%s   [file]        Converge to hpm.lock (install/switch/remove)\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %sbundle%s  <pkg>... -o <file>  Write an offline bundle with all dependencies\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %scache%s   [stats|trim]  Show cache usage or trim it to the size limit\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %scache-serve%s [--listen addr] [--blob-dir dir]  Serve cached archives to LAN peers by sha256\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %sgc%s      [--keep N]    Delete unreachable versions and leftovers\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %smirrors%s               Probe configured mirrors and show their ranking\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %sbench%s   durability|hash  Measure durability modes or SHA-256 throughput\n", COLOR_CYAN, COLOR_RESET)
+    fmt.println("Options:")
+    fmt.printf("  %s--durability=none|commit|strict%s  fsync policy for install/update/remove (default: commit)\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %s--paranoid%s                       Re-hash cached archives even if they are unchanged since verification\n", COLOR_CYAN, COLOR_RESET)
+    fmt.printf("  %s--root <dir>%s                     Manage the system tree under <dir> (download cache stays shared)\n", COLOR_CYAN, COLOR_RESET)
 }
 
 print_error :: proc(err: Error) {
@@ -246,5 +327,15 @@ print_error :: proc(err: Error) {
             fmt.printf("Clean failed.%s\n", COLOR_RESET)
         case .VerifyFailed:
             fmt.printf("Verify failed.%s\n", COLOR_RESET)
+        case .GenerationFailed:
+            fmt.printf("Failed to build profile generation.%s\n", COLOR_RESET)
+        case .GenerationNotFound:
+            fmt.printf("Generation not found.%s\n", COLOR_RESET)
+        case .CacheFailed:
+            fmt.printf("Cache index update failed.%s\n", COLOR_RESET)
+        case .BundleFailed:
+            fmt.printf("Bundle is missing or invalid.%s\n", COLOR_RESET)
+        case .LockfileFailed:
+            fmt.printf("Lockfile is missing or invalid.%s\n", COLOR_RESET)
     }
 }
@@ -0,0 +1,215 @@
+package hpm
+
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:strconv"
+import "core:time"
+import "core:sync"
+import "core:sort"
+import "core:thread"
+import "core:encoding/json"
+
+// Ranking luster: dla każdego prefiksu szacowany czas pobrania 1 MiB
+// (czas do pierwszego bajtu + 1 MiB / zmierzona przepustowość).
+// Zapisywany w cache, żeby nie sondować przy każdym pobraniu.
+MIRROR_RANK_PATH := "/var/cache/hpm/mirrors.json"
+MIRROR_RANK_TMP  := "/var/cache/hpm/mirrors.json.tmp"
+MIRROR_RANK_TTL :: 6 * time.Hour
+MIRROR_PROBE_BYTES :: 256 * 1024
+MIRROR_FAILED_SCORE :: 1e9
+CURL_RANGE_ERROR :: 33
+
+MirrorRanking :: struct {
+    probed: time.Time,
+    scores: map[string]f64,
+}
+
+MirrorCandidate :: struct {
+    prefix: string,
+    url:    string,
+    score:  f64,
+}
+
+@(private="file")
+ranking: MirrorRanking
+@(private="file")
+ranking_loaded: bool
+@(private="file")
+ranking_mutex: sync.Mutex
+
+// Wszystkie adresy, pod którymi leży url: przepisane prefiksy luster plus oryginał
+mirror_candidates :: proc(url: string) -> [dynamic]MirrorCandidate {
+    candidates: [dynamic]MirrorCandidate
+    for from, tos in config.mirrors {
+        if !strings.has_prefix(url, from) {
+            continue
+        }
+        for to in tos {
+            append(&candidates, MirrorCandidate{prefix = to, url = strings.concatenate({to, url[len(from):]}, context.temp_allocator)})
+        }
+        append(&candidates, MirrorCandidate{prefix = from, url = url})
+        return candidates
+    }
+    append(&candidates, MirrorCandidate{prefix = "", url = url})
+    return candidates
+}
+
+@(private="file")
+load_ranking :: proc() {
+    if ranking_loaded {
+        return
+    }
+    ranking_loaded = true
+    data, ok := os.read_entire_file(MIRROR_RANK_PATH)
+    if ok {
+        defer delete(data)
+        if json.unmarshal(data, &ranking) != nil {
+            ranking = {}
+        }
+    }
+    if ranking.scores == nil {
+        ranking.scores = make(map[string]f64)
+    }
+}
+
+@(private="file")
+save_ranking :: proc() {
+    data, merr := json.marshal(ranking)
+    if merr != nil {
+        return
+    }
+    defer delete(data)
+    if os.write_entire_file(MIRROR_RANK_TMP, data) {
+        os.rename(MIRROR_RANK_TMP, MIRROR_RANK_PATH)
+    }
+}
+
+// Pobiera początek pliku i mierzy czas do pierwszego bajtu oraz przepustowość
+probe_mirror :: proc(url: string) -> f64 {
+    args := []string{
+        "curl", "-sS", "-L", "--fail", "-o", "/dev/null",
+        "--connect-timeout", "3", "--max-time", "10",
+        "-r", fmt.tprintf("0-%d", MIRROR_PROBE_BYTES - 1),
+        "-w", "%{time_starttransfer} %{speed_download}",
+        url,
+    }
+    out, code, err := run_command_output(args[:], context.temp_allocator)
+    if code != 0 || err != .None {
+        return MIRROR_FAILED_SCORE
+    }
+    fields := strings.fields(out, context.temp_allocator)
+    if len(fields) < 2 {
+        return MIRROR_FAILED_SCORE
+    }
+    ttfb, ok1 := strconv.parse_f64(fields[0])
+    speed, ok2 := strconv.parse_f64(fields[1])
+    if !ok1 || !ok2 || speed <= 0 {
+        return MIRROR_FAILED_SCORE
+    }
+    return ttfb + 1024 * 1024 / speed
+}
+
+ProbeJob :: struct {
+    url:   string,
+    score: f64,
+}
+
+probe_worker :: proc(t: ^thread.Thread) {
+    job := (^ProbeJob)(t.data)
+    job.score = probe_mirror(job.url)
+}
+
+// Kandydaci posortowani od najszybszego. Nieznane lub przeterminowane prefiksy
+// są sondowane równolegle; pod mutexem, więc równoległe pobrania sondują raz.
+ranked_mirrors :: proc(url: string) -> [dynamic]MirrorCandidate {
+    candidates := mirror_candidates(url)
+    if len(candidates) == 1 {
+        return candidates
+    }
+    sync.mutex_lock(&ranking_mutex)
+    defer sync.mutex_unlock(&ranking_mutex)
+    load_ranking()
+    stale := time.diff(ranking.probed, time.now()) > MIRROR_RANK_TTL
+    jobs := make([]ProbeJob, len(candidates), context.temp_allocator)
+    threads: [dynamic]^thread.Thread
+    defer delete(threads)
+    for c, i in candidates {
+        if _, known := ranking.scores[c.prefix]; known && !stale {
+            continue
+        }
+        jobs[i] = ProbeJob{url = c.url}
+        t := thread.create(probe_worker)
+        t.data = rawptr(&jobs[i])
+        thread.start(t)
+        append(&threads, t)
+    }
+    if len(threads) > 0 {
+        for t in threads {
+            thread.join(t)
+            thread.destroy(t)
+        }
+        for c, i in candidates {
+            if jobs[i].url != "" {
+                ranking.scores[strings.clone(c.prefix)] = jobs[i].score
+                log_to_file("INFO", fmt.tprintf("mirror %s scored %.3fs/MiB", c.prefix, jobs[i].score))
+            }
+        }
+        if stale {
+            ranking.probed = time.now()
+        }
+        save_ranking()
+    }
+    for &c in candidates {
+        c.score = ranking.scores[c.prefix]
+    }
+    sort.sort(sort.Interface{
+        collection = &candidates,
+        len = proc(it: sort.Interface) -> int { return len((^[dynamic]MirrorCandidate)(it.collection)^) },
+              less = proc(it: sort.Interface, i, j: int) -> bool {
+                  arr := (^[dynamic]MirrorCandidate)(it.collection)^
+                  return arr[i].score < arr[j].score
+              },
+              swap = proc(it: sort.Interface, i, j: int) {
+                  arr := (^[dynamic]MirrorCandidate)(it.collection)^
+                  arr[i], arr[j] = arr[j], arr[i]
+              },
+    })
+    return candidates
+}
+
+// Lustro, które zawiodło w trakcie transferu, spada na koniec do następnego sondowania
+mark_mirror_failed :: proc(prefix: string) {
+    if prefix == "" {
+        return
+    }
+    sync.mutex_lock(&ranking_mutex)
+    defer sync.mutex_unlock(&ranking_mutex)
+    load_ranking()
+    ranking.scores[strings.clone(prefix)] = MIRROR_FAILED_SCORE
+    save_ranking()
+}
+
+// hpm mirrors — sonduje lustra indeksu od nowa i pokazuje ranking
+mirrors_command :: proc(allocator: mem.Allocator) -> Error {
+    if len(config.mirrors) == 0 {
+        fmt.printf("%sNo mirrors configured in %s.%s\n", COLOR_YELLOW, config_path(), COLOR_RESET)
+        return .None
+    }
+    sync.mutex_lock(&ranking_mutex)
+    load_ranking()
+    ranking.probed = {}
+    sync.mutex_unlock(&ranking_mutex)
+    candidates := ranked_mirrors(REPO_JSON_URL)
+    defer delete(candidates)
+    fmt.printf("%sMirrors for the package index (fastest first):%s\n", COLOR_BLUE, COLOR_RESET)
+    for c in candidates {
+        if c.score >= MIRROR_FAILED_SCORE {
+            fmt.printf("  %s%s%s  %sunreachable%s\n", COLOR_CYAN, c.prefix, COLOR_RESET, COLOR_RED, COLOR_RESET)
+        } else {
+            fmt.printf("  %s%s%s  %.0f ms/MiB\n", COLOR_CYAN, c.prefix, COLOR_RESET, c.score * 1000)
+        }
+    }
+    return .None
+}
@@ -1,5 +1,6 @@
 package hpm
 
+import "base:runtime"
 import "core:fmt"
 import "core:os"
 import "core:mem"
@@ -29,17 +30,25 @@ switch_version :: proc(allocator: mem.Allocator, pkg_name: string, version: stri
     if _, ok := vers_map[version]; !ok {
         return .VersionNotFound
     }
-    current_link := fmt.tprintf("%s%s/current", STORE_PATH, pkg_name)
-    defer delete(current_link)
-    if os.exists(current_link) {
-        os.remove(current_link)
-    }
-    symlink_err := linux.symlink(strings.clone_to_cstring(version, context.temp_allocator), strings.clone_to_cstring(current_link, context.temp_allocator))
-    if symlink_err != .NONE {
+    if activate_version(allocator, pkg_name, version) != .None {
         log_to_file("ERROR", "Failed to switch version")
         return .SwitchFailed
     }
     save_state(&state, allocator)
+    // Zmieniają się tylko krawędzie tego pakietu; pełny indeks, bo zainstalowana
+    // wersja mogła wypaść z indeksu hosta
+    graph := load_depgraph(allocator, &state)
+    if repo, repo_err := load_repo(allocator, true, true); repo_err == .None {
+        depgraph_set(&graph, &repo, pkg_name, version)
+        deinit_repo(&repo, allocator)
+        save_depgraph(&graph, allocator)
+    } else {
+        log_to_file("WARN", "depgraph: package index unavailable, keeping previous edges")
+    }
+    gen_err := commit_generation(allocator, &state)
+    if gen_err != .None {
+        return gen_err
+    }
     fmt.printf("%s✔ Switched %s%s%s to %s%s%s.%s\n", COLOR_GREEN, COLOR_CYAN, pkg_name, COLOR_RESET, COLOR_CYAN, version, COLOR_RESET, COLOR_RESET)
     return .None
 }
@@ -101,6 +110,13 @@ upgrade :: proc(allocator: mem.Allocator) -> Error {
 }
 
 run_tool :: proc(allocator: mem.Allocator, args: []string) -> int {
+    args := args
+    // Zapisuje profil readahead: pliki otwarte przez narzędzie przy starcie,
+    // po kolei; kolejne uruchomienia (także przez wrappery) wczytują je z wyprzedzeniem
+    record := len(args) > 0 && args[0] == "--record-readahead"
+    if record {
+        args = args[1:]
+    }
     if len(args) < 2 {
         print_error(.InvalidArgs)
         return 1
@@ -135,7 +151,13 @@ run_tool :: proc(allocator: mem.Allocator, args: []string) -> int {
         delete(backend_args)
     }
     append(&backend_args, BACKEND_PATH)
+    if install_root != "" {
+        append(&backend_args, "--root", install_root)
+    }
     append(&backend_args, "run")
+    if record {
+        append(&backend_args, "--record-readahead")
+    }
     append(&backend_args, pkg_name)
     append(&backend_args, bin)
     for arg in extra_args {
@@ -162,48 +184,31 @@ build :: proc(allocator: mem.Allocator, name: string) -> Error {
 }
 
 search :: proc(allocator: mem.Allocator, query: string) -> Error {
-    repo, repo_err := load_repo(allocator)
-    if repo_err != .None {
-        return repo_err
-    }
-    defer deinit_repo(&repo, allocator)
-    results: [dynamic]struct {name: string, ver: string, desc: string}
-    defer {
-        for res in results {
-            delete(res.name)
-            delete(res.ver)
-            delete(res.desc)
-        }
-        delete(results)
-    }
-    q_lower := strings.to_lower(query, allocator)
-    defer delete(q_lower)
-    for name, pkg in repo {
-        name_lower := strings.to_lower(name, allocator)
-        desc_lower := strings.to_lower(pkg.description, allocator)
-        if strings.contains(name_lower, q_lower) || strings.contains(desc_lower, q_lower) {
-            if len(pkg.versions) > 0 {
-                latest_ver := pkg.versions[0].version // Assume sorted or find max
-                for v in pkg.versions[1:] {
-                    if compare_versions(v.version, latest_ver) > 0 {
-                        latest_ver = v.version
-                    }
-                }
-                short_desc := pkg.description[:min(len(pkg.description), 50)]
-                append(&results, struct {name: string, ver: string, desc: string}{name = name, ver = latest_ver, desc = short_desc})
-            }
-        }
-        delete(name_lower)
-        delete(desc_lower)
+    // Kandydaci i wyniki w arenie na stercie, zwalnianej razem z indeksem po zapytaniu
+    arena: mem.Dynamic_Arena
+    mem.dynamic_arena_init(&arena, runtime.heap_allocator(), runtime.heap_allocator())
+    defer mem.dynamic_arena_destroy(&arena)
+    context.allocator = mem.dynamic_arena_allocator(&arena)
+
+    idx, ok := open_current_index(SearchIndex, open_search_index, close_search_index, build_search_index)
+    if !ok {
+        return .SearchFailed
     }
-    if len(results) == 0 {
+    defer close_search_index(&idx)
+    hits := search_index_query(&idx, query)
+    if len(hits) == 0 {
         fmt.printf("%sNo results found for '%s'.%s\n", COLOR_YELLOW, query, COLOR_RESET)
         return .None
     }
     fmt.printf("%sSearch results for '%s':%s\n", COLOR_BLUE, query, COLOR_RESET)
     fmt.printf("%sName%s\t%sVersion%s\t%sDescription%s\n", COLOR_CYAN, COLOR_RESET, COLOR_CYAN, COLOR_RESET, COLOR_CYAN, COLOR_RESET)
-    for res in results {
-        fmt.printf("%s%s%s\t%s%s%s\t%s\n", COLOR_MAGENTA, res.name, COLOR_RESET, COLOR_GREEN, res.ver, COLOR_RESET, res.desc)
+    for hit in hits[:min(len(hits), SEARCH_TOP_K)] {
+        doc := search_doc(&idx, hit.doc)
+        short_desc := doc.desc[:min(len(doc.desc), 50)]
+        fmt.printf("%s%s%s\t%s%s%s\t%s\n", COLOR_MAGENTA, doc.name, COLOR_RESET, COLOR_GREEN, doc.ver, COLOR_RESET, short_desc)
+    }
+    if len(hits) > SEARCH_TOP_K {
+        fmt.printf("%s... %d more; refine the query.%s\n", COLOR_YELLOW, len(hits) - SEARCH_TOP_K, COLOR_RESET)
     }
     return .None
 }
@@ -293,6 +298,14 @@ list_installed :: proc(allocator: mem.Allocator) -> Error {
 
 clean_cache :: proc(allocator: mem.Allocator) -> Error {
     log_to_file("INFO", "Cleaning cache")
+    use_fd, free := flock_path(CACHE_USE_LOCK, LOCK_EX | LOCK_NB)
+    if !free {
+        fmt.printf("%sCache is in use by another hpm operation.%s\n", COLOR_RED, COLOR_RESET)
+        return .CleanFailed
+    }
+    defer linux.close(use_fd)
+    index_fd := cache_index_lock()
+    defer cache_index_unlock(index_fd)
     dir, err := os.open(CACHE_PATH)
     if err != os.ERROR_NONE {
         return .CleanFailed
@@ -307,6 +320,8 @@ clean_cache :: proc(allocator: mem.Allocator) -> Error {
             delete(full_path)
         }
     }
+    os.remove(CACHE_INDEX_PATH)
+    sweep_cache_blobs(allocator)
     fmt.printf("%s✔ Cache cleaned.%s\n", COLOR_GREEN, COLOR_RESET)
     return .None
 }
@@ -463,6 +478,19 @@ deps :: proc(allocator: mem.Allocator, pkg_spec: string) -> Error {
         delete(chosen)
         delete(order)
     }
+    if req == "" {
+        if items, size, ok := lookup_closure(allocator, pkg_name); ok {
+            defer delete(items)
+            fmt.printf("%sDependency tree for %s:%s\n", COLOR_BLUE, pkg_spec, COLOR_RESET)
+            for item in items {
+                fmt.printf("- %s%s@%s%s\n", COLOR_CYAN, item.pkg, item.ver, COLOR_RESET)
+            }
+            if size > 0 {
+                fmt.printf("%sTotal download size:%s %s\n", COLOR_BLUE, COLOR_RESET, format_bytes(size))
+            }
+            return .None
+        }
+    }
     res_err := resolve_deps_iterative(allocator, &repo, pkg_name, req, &chosen, &order)
     if res_err != .None {
         return res_err
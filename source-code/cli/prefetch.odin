@@ -0,0 +1,103 @@
+package hpm
+
+import "base:intrinsics"
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:sys/linux"
+
+// hpm prefetch — do crona albo timera systemd. Odświeża indeks, wylicza to,
+// co zainstalowałby `update`, i pobiera brakujące archiwa do cache w tle:
+// nice 19, ioprio idle, z limitem pasma. Niczego nie instaluje, więc
+// późniejszy update ma już tylko weryfikację i rozpakowanie.
+IOPRIO_WHO_PROCESS :: 1
+IOPRIO_CLASS_IDLE  :: 3
+IOPRIO_CLASS_SHIFT :: 13
+
+// Dziedziczą to także procesy curl uruchamiane przez download_file
+lower_process_priority :: proc() {
+    intrinsics.syscall(linux.SYS_setpriority, 0, 0, 19)
+    intrinsics.syscall(linux.SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT)
+}
+
+prefetch :: proc(allocator: mem.Allocator, args: []string) -> Error {
+    limit := config.prefetch_limit_rate
+    do_refresh := true
+    for i := 0; i < len(args); i += 1 {
+        switch {
+            case args[i] == "--no-refresh":
+                do_refresh = false
+            case args[i] == "--limit-rate" && i + 1 < len(args):
+                limit = args[i + 1]
+                i += 1
+            case strings.has_prefix(args[i], "--limit-rate="):
+                limit = strings.trim_prefix(args[i], "--limit-rate=")
+            case:
+                return .InvalidArgs
+        }
+    }
+    // Trwająca transakcja ma pierwszeństwo; spróbujemy przy następnym uruchomieniu
+    if lock_busy() {
+        fmt.printf("%s➤ Another hpm operation is running, skipping prefetch.%s\n", COLOR_YELLOW, COLOR_RESET)
+        return .None
+    }
+    lower_process_priority()
+    download_rate_limit = limit
+    if do_refresh {
+        if err := refresh(allocator); err != .None {
+            log_to_file("WARN", "prefetch: refresh failed, using the current index")
+        }
+    }
+
+    // Blokada tylko na czas planowania; pobieranie nie blokuje update ani install
+    lock_err := acquire_lock()
+    if lock_err != .None {
+        return lock_err
+    }
+    repo, repo_err := load_repo(allocator)
+    if repo_err != .None {
+        release_lock()
+        return repo_err
+    }
+    defer deinit_repo(&repo, allocator)
+    state, state_err := load_state(allocator)
+    if state_err != .None {
+        release_lock()
+        return state_err
+    }
+    defer delete_state(&state, allocator)
+    plan, _ := plan_updates(allocator, &repo, &state)
+    defer delete(plan)
+    release_lock()
+
+    fetched, cached, failed := 0, 0, 0
+    bytes: i64 = 0
+    for step in plan {
+        archive := cache_archive_path(step.pkg, step.to)
+        if os.exists(archive) {
+            cached += 1
+            continue
+        }
+        if err := fetch_archive(allocator, step.pkg, step.to, step.url, step.sha256, true, step.size); err != .None {
+            fmt.printf("%s✖ %s@%s: %v%s\n", COLOR_RED, step.pkg, step.to, err, COLOR_RESET)
+            failed += 1
+            continue
+        }
+        if st, err := os.stat(archive, context.temp_allocator); err == os.ERROR_NONE {
+            bytes += st.size
+        }
+        fmt.printf("%s↓ %s@%s%s\n", COLOR_CYAN, step.pkg, step.to, COLOR_RESET)
+        fetched += 1
+    }
+    log_to_file("INFO", fmt.tprintf("prefetch: %d fetched (%d bytes), %d cached, %d failed", fetched, bytes, cached, failed))
+    if len(plan) == 0 {
+        fmt.printf("%s✔ No pending updates.%s\n", COLOR_GREEN, COLOR_RESET)
+        return .None
+    }
+    fmt.printf("%s✔ Prefetched %d archive(s) (%s), %d already cached. 'hpm update' will not need to download them.%s\n", COLOR_GREEN, fetched, format_bytes(bytes), cached, COLOR_RESET)
+    if failed > 0 {
+        return .DownloadFailed
+    }
+    return .None
+}
@@ -0,0 +1,326 @@
+package hpm
+
+import "base:runtime"
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:sort"
+
+// Indeksy pomocnicze do `hpm query`, budowane przy refresh razem z search.idx.
+// Każde pole to posortowana tablica kluczy z listą dokumentów, więc zapytanie
+// to wyszukiwanie binarne plus przejście po wyniku — bez skanowania repo.
+// Format (little endian):
+//   "HPMQRY01", u32 ndocs, u32 blob, [64]u8 sha256 repo.json
+//   dla każdego pola z QueryField, po kolei:
+//     u32 nkeys, u32 npost
+//     nkeys x {u32 key_off, u32 key_len, u32 post_off, u32 count}   posortowane po kluczu
+//     npost x u32
+//   ndocs x {u32 name_off, u32 name_len, u32 ver_off, u32 ver_len}  pakiety alfabetycznie
+//   blob
+QUERY_INDEX_PATH := "/usr/lib/HackerOS/hpm/query.idx"
+QUERY_INDEX_TMP  := "/usr/lib/HackerOS/hpm/query.idx.tmp"
+QUERY_INDEX_MAGIC :: "HPMQRY01"
+QUERY_HEADER_SIZE :: 8 + 4 * 2 + 64
+
+// Pola indeksowane dla najnowszej wersji pakietu. author, license i bin
+// są porównywane bez wielkości liter, depends po dokładnej nazwie pakietu.
+QueryField :: enum {
+    Depends,
+    Author,
+    License,
+    Bin,
+}
+
+QUERY_FIELD_NAMES := [QueryField]string{
+    .Depends = "depends",
+    .Author  = "author",
+    .License = "license",
+    .Bin     = "bin",
+}
+
+QuerySection :: struct {
+    nkeys:    int,
+    key_off:  int,
+    post_off: int,
+}
+
+QueryIndex :: struct {
+    data:     []u8,
+    ndocs:    int,
+    sections: [QueryField]QuerySection,
+    doc_off:  int,
+    blob_off: int,
+    sha256:   string,
+}
+
+QueryTerm :: struct {
+    field:  QueryField,
+    value:  string,
+    negate: bool,
+}
+
+query_key :: proc(field: QueryField, value: string) -> string {
+    return field == .Depends ? value : strings.to_lower(value)
+}
+
+build_query_index :: proc(repo_sha: string) -> bool {
+    arena: mem.Dynamic_Arena
+    mem.dynamic_arena_init(&arena, runtime.heap_allocator(), runtime.heap_allocator())
+    defer mem.dynamic_arena_destroy(&arena)
+    context.allocator = mem.dynamic_arena_allocator(&arena)
+
+    repo, repo_err := load_repo(context.allocator, true)
+    if repo_err != .None {
+        return false
+    }
+    names: [dynamic]string
+    for name in repo {
+        append(&names, name)
+    }
+    sort.quick_sort(names[:])
+
+    tables: [QueryField]map[string][dynamic]u32
+    for &t in tables {
+        t = make(map[string][dynamic]u32)
+    }
+    add :: proc(t: ^map[string][dynamic]u32, key: string, doc: int) {
+        if key == "" {
+            return
+        }
+        if key not_in t^ {
+            t^[key] = make([dynamic]u32)
+        }
+        list := &t^[key]
+        if len(list^) == 0 || list^[len(list^) - 1] != u32(doc) {
+            append(list, u32(doc))
+        }
+    }
+    blob: [dynamic]u8
+    docs: [dynamic]u32
+    for name, doc in names {
+        pkg := repo[name]
+        latest := latest_version(pkg)
+        append(&docs, u32(len(blob)), u32(len(name)))
+        append(&blob, name)
+        append(&docs, u32(len(blob)), u32(len(latest)))
+        append(&blob, latest)
+        add(&tables[.Author], query_key(.Author, pkg.author), doc)
+        add(&tables[.License], query_key(.License, pkg.license), doc)
+        ver_obj, ok := find_version(pkg, latest)
+        if !ok {
+            continue
+        }
+        for dep in ver_obj.deps {
+            add(&tables[.Depends], dep, doc)
+        }
+        for bin in ver_obj.bins {
+            add(&tables[.Bin], query_key(.Bin, bin), doc)
+        }
+    }
+
+    // Klucze trafiają do bloba przed nagłówkiem, więc najpierw wyliczamy sekcje
+    sections: [dynamic]u8
+    for t in tables {
+        keys: [dynamic]string
+        npost := 0
+        for key, list in t {
+            append(&keys, key)
+            npost += len(list)
+        }
+        sort.quick_sort(keys[:])
+        put_u32le(&sections, u32(len(keys)))
+        put_u32le(&sections, u32(npost))
+        off: u32 = 0
+        for key in keys {
+            put_u32le(&sections, u32(len(blob)))
+            put_u32le(&sections, u32(len(key)))
+            append(&blob, key)
+            put_u32le(&sections, off)
+            put_u32le(&sections, u32(len(t[key])))
+            off += u32(len(t[key]))
+        }
+        for key in keys {
+            for doc in t[key] {
+                put_u32le(&sections, doc)
+            }
+        }
+    }
+
+    out: [dynamic]u8
+    append(&out, QUERY_INDEX_MAGIC)
+    put_u32le(&out, u32(len(names)))
+    put_u32le(&out, u32(len(blob)))
+    sha_field: [64]u8
+    copy(sha_field[:], repo_sha)
+    append(&out, ..sha_field[:])
+    append(&out, ..sections[:])
+    for v in docs {
+        put_u32le(&out, v)
+    }
+    append(&out, ..blob[:])
+    if !os.write_entire_file(QUERY_INDEX_TMP, out[:]) {
+        return false
+    }
+    if os.rename(QUERY_INDEX_TMP, QUERY_INDEX_PATH) != os.ERROR_NONE {
+        os.remove(QUERY_INDEX_TMP)
+        return false
+    }
+    log_to_file("INFO", fmt.tprintf("query index: %d packages", len(names)))
+    return true
+}
+
+open_query_index :: proc() -> (QueryIndex, bool) {
+    data, ok := read_index_file(QUERY_INDEX_PATH, QUERY_INDEX_MAGIC, QUERY_HEADER_SIZE)
+    if !ok {
+        return {}, false
+    }
+    idx := QueryIndex{data = data}
+    idx.ndocs = int(get_u32le(data[8:]))
+    blob_len := int(get_u32le(data[12:]))
+    idx.sha256 = strings.trim_right_null(string(data[16:80]))
+    pos := QUERY_HEADER_SIZE
+    for &s in idx.sections {
+        if pos + 8 > len(data) {
+            free_index_file(data)
+            return {}, false
+        }
+        s.nkeys = int(get_u32le(data[pos:]))
+        npost := int(get_u32le(data[pos+4:]))
+        s.key_off = pos + 8
+        s.post_off = s.key_off + 16 * s.nkeys
+        pos = s.post_off + 4 * npost
+    }
+    idx.doc_off = pos
+    idx.blob_off = idx.doc_off + 16 * idx.ndocs
+    if idx.blob_off + blob_len != len(data) {
+        free_index_file(data)
+        return {}, false
+    }
+    return idx, true
+}
+
+close_query_index :: proc(idx: ^QueryIndex) {
+    free_index_file(idx.data)
+    idx^ = {}
+}
+
+query_blob :: proc(idx: ^QueryIndex, p: int) -> string {
+    off := idx.blob_off + int(get_u32le(idx.data[p:]))
+    return string(idx.data[off:off + int(get_u32le(idx.data[p+4:]))])
+}
+
+query_doc :: proc(idx: ^QueryIndex, doc: int) -> (name: string, ver: string) {
+    p := idx.doc_off + 16 * doc
+    return query_blob(idx, p), query_blob(idx, p + 8)
+}
+
+// Dokumenty dla klucza: wyszukiwanie binarne, wynik to widok na listę w pliku
+query_lookup :: proc(idx: ^QueryIndex, field: QueryField, key: string) -> []u8 {
+    s := idx.sections[field]
+    lo, hi := 0, s.nkeys
+    for lo < hi {
+        mid := (lo + hi) / 2
+        p := s.key_off + 16 * mid
+        k := query_blob(idx, p)
+        if k == key {
+            off := s.post_off + 4 * int(get_u32le(idx.data[p+8:]))
+            return idx.data[off:off + 4 * int(get_u32le(idx.data[p+12:]))]
+        }
+        if k < key {
+            lo = mid + 1
+        } else {
+            hi = mid
+        }
+    }
+    return nil
+}
+
+// <pole>=<wartość> albo <pole>!=<wartość>
+parse_query_term :: proc(arg: string) -> (QueryTerm, bool) {
+    negate := false
+    eq := strings.index(arg, "!=")
+    vstart := eq + 2
+    if eq >= 0 {
+        negate = true
+    } else {
+        eq = strings.index_byte(arg, '=')
+        vstart = eq + 1
+    }
+    if eq <= 0 || vstart >= len(arg) {
+        return {}, false
+    }
+    for name, field in QUERY_FIELD_NAMES {
+        if name == arg[:eq] {
+            return QueryTerm{field, query_key(field, arg[vstart:]), negate}, true
+        }
+    }
+    return {}, false
+}
+
+// Przecięcie warunków pozytywnych od najkrótszej listy, potem odfiltrowanie
+// negacji. Sama negacja musi przejść po wszystkich pakietach poza wynikiem.
+run_query :: proc(idx: ^QueryIndex, terms: []QueryTerm) -> [dynamic]u32 {
+    result: [dynamic]u32
+    positive: [dynamic][]u8
+    negative: [dynamic][]u8
+    defer {
+        delete(positive)
+        delete(negative)
+    }
+    for term in terms {
+        list := query_lookup(idx, term.field, term.value)
+        if term.negate {
+            append(&negative, list)
+        } else {
+            if list == nil {
+                return result
+            }
+            append(&positive, list)
+        }
+    }
+    if len(positive) == 0 {
+        for doc in 0..<idx.ndocs {
+            append(&result, u32(doc))
+        }
+    } else {
+        result = intersect_lists(positive[:])
+    }
+    for list in negative {
+        intersect_postings(&result, list, true)
+    }
+    return result
+}
+
+// hpm query <pole>[!]=<wartość>... — warunki łączone przez AND
+query :: proc(allocator: mem.Allocator, args: []string) -> Error {
+    if len(args) == 0 {
+        return .InvalidArgs
+    }
+    terms := make([]QueryTerm, len(args), allocator)
+    defer delete(terms)
+    for arg, i in args {
+        term, ok := parse_query_term(arg)
+        if !ok {
+            fmt.printf("%s✖ Invalid query term '%s' (fields: depends, author, license, bin).%s\n", COLOR_RED, arg, COLOR_RESET)
+            return .InvalidArgs
+        }
+        terms[i] = term
+    }
+    idx, ok := open_current_index(QueryIndex, open_query_index, close_query_index, build_query_index)
+    if !ok {
+        return .SearchFailed
+    }
+    defer close_query_index(&idx)
+    result := run_query(&idx, terms)
+    defer delete(result)
+    if len(result) == 0 {
+        fmt.printf("%sNo packages match.%s\n", COLOR_YELLOW, COLOR_RESET)
+        return .None
+    }
+    for doc in result {
+        name, ver := query_doc(&idx, int(doc))
+        fmt.printf("%s%s%s\t%s%s%s\n", COLOR_MAGENTA, name, COLOR_RESET, COLOR_GREEN, ver, COLOR_RESET)
+    }
+    return .None
+}
@@ -0,0 +1,315 @@
+package hpm
+
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:strconv"
+import "core:encoding/json"
+
+// Odświeżanie indeksu w kolejności od najtańszego:
+//   1. delty — repo.seq mówi, ile zmian przybyło; jeśli niewiele, pobieramy
+//      tylko deltas/<n>.json i nakładamy je lokalnie,
+//   2. warunkowy GET repo.json.zst (ETag + If-Modified-Since) — 304 kosztuje nagłówki,
+//   3. warunkowy GET repo.json, gdy serwer nie ma wariantu zstd.
+// Bez zmian niczego nie zapisujemy i niczego pochodnego nie przebudowujemy.
+REPO_META_PATH := "/usr/lib/HackerOS/hpm/repo.meta.json"
+REPO_ETAG_PATH := "/usr/lib/HackerOS/hpm/repo.etag"
+REPO_ZST_TMP   := "/usr/lib/HackerOS/hpm/repo.json.zst.tmp"
+REPO_SEQ_TMP   := "/usr/lib/HackerOS/hpm/repo.seq.tmp"
+REPO_DELTA_TMP := "/usr/lib/HackerOS/hpm/repo.delta.tmp"
+MAX_INDEX_DELTAS :: 32
+
+IndexMeta :: struct {
+    seq:     int,    // numer sekwencyjny lokalnego indeksu (0 = serwer nie publikuje delt)
+    variant: string, // "zst" albo "json"
+    sha256:  string, // skrót lokalnego repo.json
+    host:    string, // odcisk, dla którego zbudowano repo.host.json
+}
+
+// Delta n przeprowadza indeks z n-1 do n; pakiety są podmieniane w całości,
+// więc nałożenie delty na nowszy indeks niczego nie psuje
+RepoDelta :: struct {
+    set:    Repo,
+    remove: [dynamic]string,
+}
+
+FetchStatus :: enum {
+    Changed,
+    NotModified,
+    Missing,
+}
+
+load_index_meta :: proc(allocator: mem.Allocator) -> IndexMeta {
+    meta: IndexMeta
+    data, ok := os.read_entire_file(REPO_META_PATH, allocator)
+    if !ok {
+        return meta
+    }
+    defer delete(data)
+    if json.unmarshal(data, &meta, allocator = allocator) != nil {
+        return IndexMeta{}
+    }
+    return meta
+}
+
+save_index_meta :: proc(meta: ^IndexMeta, allocator: mem.Allocator) {
+    data, merr := json.marshal(meta^, allocator = allocator)
+    if merr != nil {
+        return
+    }
+    defer delete(data)
+    tmp := fmt.tprintf("%s.tmp", REPO_META_PATH)
+    if os.write_entire_file(tmp, data) {
+        os.rename(tmp, REPO_META_PATH)
+    }
+}
+
+index_base_url :: proc() -> string {
+    return REPO_JSON_URL[:strings.last_index(REPO_JSON_URL, "/") + 1]
+}
+
+// GET z walidatorami z poprzedniego pobrania. ETag zapisujemy tylko przy 200,
+// żeby nieudana próba nie zgubiła poprzedniego.
+fetch_conditional :: proc(url: string, dest: string, etag_path: string, since_path: string) -> (FetchStatus, Error) {
+    etag_new := fmt.tprintf("%s.new", etag_path)
+    candidates := ranked_mirrors(url)
+    defer delete(candidates)
+    for c in candidates {
+        args: [dynamic]string
+        append(&args, "curl", "-sS", "-L", "--connect-timeout", "5", "--speed-limit", "1024", "--speed-time", "15")
+        append(&args, "-o", dest, "-w", "%{http_code}", "--etag-save", etag_new)
+        if os.exists(etag_path) {
+            append(&args, "--etag-compare", etag_path)
+        }
+        if since_path != "" && os.exists(since_path) {
+            append(&args, "-z", since_path)
+        }
+        append(&args, c.url)
+        out, code, err := run_command_output(args[:], context.temp_allocator)
+        delete(args)
+        status := strings.trim_space(out)
+        if code == 0 && err == .None {
+            switch status {
+                case "200":
+                    if os.exists(etag_new) {
+                        os.rename(etag_new, etag_path)
+                    }
+                    return .Changed, .None
+                case "304":
+                    os.remove(etag_new)
+                    os.remove(dest)
+                    return .NotModified, .None
+                case "404", "410":
+                    os.remove(etag_new)
+                    os.remove(dest)
+                    return .Missing, .None
+            }
+        }
+        log_to_file("WARN", fmt.tprintf("refresh: %s failed (curl=%d, http=%s)", c.url, code, status))
+        os.remove(dest)
+        mark_mirror_failed(c.prefix)
+    }
+    os.remove(etag_new)
+    return .Missing, .DownloadFailed
+}
+
+// Numer sekwencyjny indeksu na serwerze; 0, gdy serwer nie publikuje delt.
+// Jedno zapytanie do źródła, bez przełączania luster: brak repo.seq (np. na
+// GitHubie) to zwykły stan, nie awaria, i nie może psuć rankingu luster.
+fetch_remote_seq :: proc(allocator: mem.Allocator) -> int {
+    url := fmt.tprintf("%srepo.seq", index_base_url())
+    args := []string{"curl", "-sS", "-L", "--connect-timeout", "5", "--max-time", "15", "-o", REPO_SEQ_TMP, "-w", "%{http_code}", url}
+    out, code, err := run_command_output(args, context.temp_allocator)
+    defer os.remove(REPO_SEQ_TMP)
+    if code != 0 || err != .None || strings.trim_space(out) != "200" {
+        return 0
+    }
+    data, ok := os.read_entire_file(REPO_SEQ_TMP, allocator)
+    if !ok {
+        return 0
+    }
+    defer delete(data)
+    seq, pok := strconv.parse_int(strings.trim_space(string(data)))
+    return pok ? seq : 0
+}
+
+// Nakłada delty local+1..remote na lokalny indeks i zapisuje go do REPO_JSON_TMP
+apply_index_deltas :: proc(allocator: mem.Allocator, from: int, to: int) -> bool {
+    repo, repo_err := load_repo(allocator, true, true)
+    if repo_err != .None {
+        return false
+    }
+    defer deinit_repo(&repo, allocator)
+    for n in from + 1..=to {
+        url := fmt.tprintf("%sdeltas/%d.json", index_base_url(), n)
+        if download_file(allocator, url, REPO_DELTA_TMP, true) != .None {
+            log_to_file("WARN", fmt.tprintf("refresh: delta %d unavailable", n))
+            return false
+        }
+        data, ok := os.read_entire_file(REPO_DELTA_TMP, allocator)
+        os.remove(REPO_DELTA_TMP)
+        if !ok {
+            return false
+        }
+        delta: RepoDelta
+        if json.unmarshal(data, &delta, allocator = allocator) != nil {
+            log_to_file("WARN", fmt.tprintf("refresh: delta %d is invalid", n))
+            return false
+        }
+        for pkg in delta.remove {
+            delete_key(&repo, pkg)
+        }
+        for pkg, entry in delta.set {
+            repo[pkg] = entry
+        }
+    }
+    data, merr := json.marshal(repo, allocator = allocator)
+    if merr != nil {
+        return false
+    }
+    defer delete(data)
+    return os.write_entire_file(REPO_JSON_TMP, data)
+}
+
+// ETag osobno dla każdego wariantu — ETag z .zst nie pasuje do repo.json
+repo_etag_path :: proc(variant: string) -> string {
+    return fmt.tprintf("%s.%s", REPO_ETAG_PATH, variant)
+}
+
+// Pełny indeks: najpierw wariant zstd, potem zwykły JSON
+fetch_full_index :: proc(meta: ^IndexMeta, have_local: bool) -> (bool, Error) {
+    // Bez lokalnej kopii walidatory nie mają sensu
+    if !have_local {
+        os.remove(repo_etag_path("zst"))
+        os.remove(repo_etag_path("json"))
+    }
+    since := have_local ? REPO_JSON_PATH : ""
+    status, err := fetch_conditional(fmt.tprintf("%s.zst", REPO_JSON_URL), REPO_ZST_TMP, repo_etag_path("zst"), since)
+    if err != .None {
+        return false, err
+    }
+    switch status {
+        case .NotModified:
+            return false, .None
+        case .Changed:
+            unpack := []string{"zstd", "-d", "-q", "-f", "-o", REPO_JSON_TMP, REPO_ZST_TMP}
+            code, run_err := run_command(unpack[:])
+            os.remove(REPO_ZST_TMP)
+            if code != 0 || run_err != .None {
+                return false, .UnpackFailed
+            }
+            meta.variant = "zst"
+            return true, .None
+        case .Missing:
+    }
+    status, err = fetch_conditional(REPO_JSON_URL, REPO_JSON_TMP, repo_etag_path("json"), since)
+    if err != .None {
+        return false, err
+    }
+    if status == .Missing {
+        return false, .DownloadFailed
+    }
+    meta.variant = "json"
+    return status == .Changed, .None
+}
+
+// Przebudowa wszystkiego, co wyliczamy z repo.json; tylko po faktycznej zmianie
+// Indeks hosta idzie pierwszy, bo pozostałe są budowane już z niego
+index_changed :: proc(meta: ^IndexMeta) {
+    clear_resolve_cache()
+    if !build_host_index(context.allocator, meta) {
+        log_to_file("WARN", "Failed to build host index")
+    }
+    if !build_search_index(meta.sha256) {
+        log_to_file("WARN", "Failed to build search index")
+    }
+    if !build_query_index(meta.sha256) {
+        log_to_file("WARN", "Failed to build query index")
+    }
+    if !build_closure_index(meta.sha256) {
+        log_to_file("WARN", "Failed to build closure index")
+    }
+}
+
+// Indeks się nie zmienił, ale host tak (nowe jądro, inna libc): kompilujemy od nowa
+host_facts_changed :: proc(meta: ^IndexMeta) {
+    if meta.sha256 != "" && meta.host != host_fingerprint(meta.sha256, host_facts()) {
+        log_to_file("INFO", "refresh: host facts changed, recompiling host index")
+        index_changed(meta)
+    }
+}
+
+refresh :: proc(allocator: mem.Allocator) -> Error {
+    log_to_file("INFO", "Refreshing package index")
+    if !makedirs(rooted("/usr/lib/HackerOS/hpm")) {
+        log_to_file("ERROR", "Failed to create /usr/lib/HackerOS/hpm")
+        return .BackendFailed
+    }
+    meta := load_index_meta(allocator)
+    have_local := os.exists(REPO_JSON_PATH)
+    // Numer sekwencyjny pobieramy przed indeksem: indeks jest co najmniej tak nowy
+    remote_seq := fetch_remote_seq(allocator)
+    changed := false
+    if have_local && meta.seq > 0 && remote_seq > 0 {
+        if remote_seq == meta.seq {
+            host_facts_changed(&meta)
+            fmt.printf("%s✔ Package index is up to date.%s\n", COLOR_GREEN, COLOR_RESET)
+            return .None
+        }
+        if remote_seq > meta.seq && remote_seq - meta.seq <= MAX_INDEX_DELTAS {
+            changed = apply_index_deltas(allocator, meta.seq, remote_seq)
+            if changed {
+                log_to_file("INFO", fmt.tprintf("refresh: applied deltas %d..%d", meta.seq + 1, remote_seq))
+            }
+        }
+    }
+    if !changed {
+        full_changed, err := fetch_full_index(&meta, have_local)
+        if err != .None {
+            log_to_file("ERROR", "Download failed for repo.json")
+            return err
+        }
+        if !full_changed {
+            if meta.seq != remote_seq {
+                meta.seq = remote_seq
+                save_index_meta(&meta, allocator)
+            }
+            host_facts_changed(&meta)
+            fmt.printf("%s✔ Package index is up to date.%s\n", COLOR_GREEN, COLOR_RESET)
+            return .None
+        }
+    }
+
+    // Nie podmieniamy działającego indeksu na coś, czego nie da się wczytać
+    data, ok := os.read_entire_file(REPO_JSON_TMP, allocator)
+    if !ok {
+        return .RepoLoadFailed
+    }
+    check: Repo
+    parse_err := json.unmarshal(data, &check, allocator = allocator)
+    delete(data)
+    if parse_err != nil {
+        log_to_file("ERROR", "Refreshed repo.json is not valid JSON")
+        os.remove(REPO_JSON_TMP)
+        os.remove(repo_etag_path(meta.variant))
+        return .RepoLoadFailed
+    }
+    deinit_repo(&check, allocator)
+    sha, sha_err := compute_sha256_stream(allocator, REPO_JSON_TMP)
+    if sha_err != .None {
+        return sha_err
+    }
+    if os.rename(REPO_JSON_TMP, REPO_JSON_PATH) != os.ERROR_NONE {
+        log_to_file("ERROR", "Failed to rename repo.json.tmp -> repo.json")
+        os.remove(REPO_JSON_TMP)
+        return .BackendFailed
+    }
+    meta.seq = remote_seq
+    meta.sha256 = sha
+    save_index_meta(&meta, allocator)
+    index_changed(&meta)
+
+    fmt.printf("%s✔ Package index refreshed.%s\n", COLOR_GREEN, COLOR_RESET)
+    return .None
+}
@@ -6,7 +6,7 @@ import "core:mem"
 import "core:strings"
 import "core:path/filepath"
 
-remove :: proc(allocator: mem.Allocator, pkg_spec: string, non_interactive: bool = false) -> Error {
+remove :: proc(allocator: mem.Allocator, pkg_spec: string, non_interactive: bool = false, force: bool = false) -> Error {
     lock_err := acquire_lock()
     if lock_err != .None {
         return lock_err
@@ -27,6 +27,18 @@ remove :: proc(allocator: mem.Allocator, pkg_spec: string, non_interactive: bool
         return .PackageNotFound
     }
     vers_map := state[pkg_name]
+    graph := load_depgraph(allocator, &state)
+    // Usunięcie aktywnej wersji psuje pakiety, które od niej zależą
+    installed, _ := get_installed(allocator, &state)
+    defer delete(installed)
+    if !force && (version == "" || installed[pkg_name] == version) {
+        dependents := installed_dependents(&graph, &state, pkg_name)
+        defer delete(dependents)
+        if len(dependents) > 0 {
+            fmt.printf("%s✖ %s is required by: %s. Use --force to remove it anyway.%s\n", COLOR_RED, pkg_name, strings.join(dependents[:], ", ", context.temp_allocator), COLOR_RESET)
+            return .Conflict
+        }
+    }
     confirm_all := version == ""
     if !non_interactive {
         if confirm_all {
@@ -42,57 +54,72 @@ remove :: proc(allocator: mem.Allocator, pkg_spec: string, non_interactive: bool
             return .None
         }
     }
-    current_link := fmt.tprintf("%s%s/current", STORE_PATH, pkg_name)
-    defer delete(current_link, allocator)
     if version != "" {
         if _, ok := vers_map[version]; !ok {
             fmt.printf("%sVersion %s not installed.%s\n", COLOR_RED, version, COLOR_RESET)
             return .VersionNotFound
         }
-        installed_path := fmt.tprintf("%s%s/%s", STORE_PATH, pkg_name, version)
-        defer delete(installed_path, allocator)
-        backend_args := []string{BACKEND_PATH, "remove", pkg_name, version, installed_path}
-        _, run_err := run_command(backend_args[:])
-        if run_err != .None {
-            return run_err
-        }
-        os.remove_directory(installed_path)
-        target, ok := readlink(current_link, allocator)
-        if ok {
-            if filepath.base(target) == version {
-                os.remove(current_link)
-            }
-            delete(target, allocator)
-        }
-        delete_key(&vers_map, version)
-        if len(vers_map) == 0 {
-            delete_key(&state, pkg_name)
-            os.remove_directory(fmt.tprintf("%s%s", STORE_PATH, pkg_name))
+        rem_err := remove_version(allocator, &state, pkg_name, version)
+        if rem_err != .None {
+            return rem_err
         }
     } else {
-        vers_keys: [dynamic]string
-        defer delete(vers_keys)
-        for ver_key in vers_map {
-            append(&vers_keys, strings.clone(ver_key, allocator))
+        rem_err := remove_all_versions(allocator, &state, pkg_name)
+        if rem_err != .None {
+            return rem_err
         }
-        for ver in vers_keys {
-            installed_path := fmt.tprintf("%s%s/%s", STORE_PATH, pkg_name, ver)
-            defer delete(installed_path, allocator)
-            backend_args := []string{BACKEND_PATH, "remove", pkg_name, ver, installed_path}
-            _, run_err := run_command(backend_args[:])
-            if run_err != .None {
-                return run_err
-            }
-            os.remove_directory(installed_path)
-            delete_key(&vers_map, ver)
-        }
-        os.remove_directory(fmt.tprintf("%s%s", STORE_PATH, pkg_name))
-        delete_key(&state, pkg_name)
     }
+    if pkg_name not_in state {
+        depgraph_drop(&graph, pkg_name)
+    }
+    durable_barrier(STORE_PATH, STATE_PATH)
     err_save := save_state(&state, allocator)
     if err_save != .None {
         return err_save
     }
+    save_depgraph(&graph, allocator)
+    gen_err := commit_generation(allocator, &state)
+    if gen_err != .None {
+        return gen_err
+    }
+    collect_unreferenced(allocator, &state)
     fmt.printf("%s✔ %s removed.%s\n", COLOR_GREEN, pkg_spec, COLOR_RESET)
     return .None
 }
+
+// Usuwa jedną wersję ze stanu i zdejmuje current, jeśli na nią wskazywał
+// (bez blokady i bez pytania). Drzewo zostaje w store: ostatnie generacje mogą
+// go potrzebować przy rollbacku, a kasuje je gc_store, gdy żadna już go nie trzyma.
+remove_version :: proc(allocator: mem.Allocator, state: ^StatePackages, pkg_name: string, version: string) -> Error {
+    current_link := fmt.tprintf("%s%s/current", STORE_PATH, pkg_name)
+    defer delete(current_link, allocator)
+    target, ok := readlink(current_link, allocator)
+    if ok {
+        if filepath.base(target) == version {
+            os.remove(current_link)
+        }
+        delete(target, allocator)
+    }
+    vers_map := state^[pkg_name]
+    delete_key(&vers_map, version)
+    state^[pkg_name] = vers_map
+    if len(vers_map) == 0 {
+        delete_key(state, pkg_name)
+    }
+    return .None
+}
+
+remove_all_versions :: proc(allocator: mem.Allocator, state: ^StatePackages, pkg_name: string) -> Error {
+    vers_keys: [dynamic]string
+    defer delete(vers_keys)
+    for ver_key in state^[pkg_name] {
+        append(&vers_keys, strings.clone(ver_key, allocator))
+    }
+    for ver in vers_keys {
+        rem_err := remove_version(allocator, state, pkg_name, ver)
+        if rem_err != .None {
+            return rem_err
+        }
+    }
+    return .None
+}
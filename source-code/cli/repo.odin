@@ -6,32 +6,56 @@ import "core:strings"
 import "core:encoding/json"
 import "core:strconv"
 import "core:sort"
+RepoVersion :: struct {
+    version: string,
+    url: string,
+    sha256: string,
+    deps: map[string]string,
+    bins: [dynamic]string, // opcjonalne; używane tylko przez indeks wyszukiwania
+    size: i64,             // opcjonalny rozmiar archiwum w bajtach
+    specs: map[string]string, // opcjonalne [specs] z manifestu: arch, libc, kernel
+    digest_algo: string,      // opcjonalne: "sha256" (domyślnie) albo "blake3"
+    digest: string,           // skrót archiwum w digest_algo; pusty = pole sha256
+}
 RepoPackage :: struct {
     author: string,
     license: string,
     description: string,
-    versions: [dynamic]struct {
-        version: string,
-        url: string,
-        sha256: string,
-        deps: map[string]string,
-    },
+    versions: [dynamic]RepoVersion,
 }
 Repo :: map[string]RepoPackage
-load_repo :: proc(allocator: mem.Allocator) -> (Repo, Error) {
-    repo_path := "/usr/lib/HackerOS/hpm/repo.json"
+PkgVer :: struct {
+    pkg: string,
+    ver: string,
+}
+// Domyślnie indeks skompilowany dla hosta; full wymusza pełny repo.json
+// (delty, paczki offline dla innych maszyn, krawędzie już zainstalowanych wersji)
+load_repo :: proc(allocator: mem.Allocator, quiet: bool = false, full: bool = false) -> (Repo, Error) {
+    repo_path := REPO_JSON_PATH
+    filter := false
+    if !full {
+        if host_index_current(allocator) {
+            repo_path = HOST_INDEX_PATH
+        } else {
+            // Indeks hosta nieaktualny (np. nowe jądro) — filtrujemy w pamięci do następnego refresh
+            filter = true
+        }
+    }
     data, ok := os.read_entire_file(repo_path, allocator)
     if !ok {
-        print_error(.RepoLoadFailed)
+        if !quiet { print_error(.RepoLoadFailed) }
         return {}, .RepoLoadFailed
     }
     defer delete(data)
     repo: Repo
     err := json.unmarshal(data, &repo, allocator = allocator)
     if err != nil {
-        print_error(.RepoLoadFailed)
+        if !quiet { print_error(.RepoLoadFailed) }
         return {}, .RepoLoadFailed
     }
+    if filter {
+        filter_repo_for_host(&repo, host_facts())
+    }
     return repo, .None
 }
 deinit_repo :: proc(repo: ^Repo, allocator: mem.Allocator) {
@@ -45,16 +69,47 @@ deinit_repo :: proc(repo: ^Repo, allocator: mem.Allocator) {
             delete(v.version, allocator)
             delete(v.url, allocator)
             delete(v.sha256, allocator)
+            delete(v.digest_algo, allocator)
+            delete(v.digest, allocator)
             for dk, dv in v.deps {
                 delete(dk, allocator)
                 delete(dv, allocator)
             }
             delete(v.deps)
+            for b in v.bins {
+                delete(b, allocator)
+            }
+            delete(v.bins)
+            for sk, sv in v.specs {
+                delete(sk, allocator)
+                delete(sv, allocator)
+            }
+            delete(v.specs)
         }
         delete(val.versions)
     }
     delete(repo^)
 }
+find_version :: proc(pkg: RepoPackage, version: string) -> (RepoVersion, bool) {
+    for v in pkg.versions {
+        if v.version == version {
+            return v, true
+        }
+    }
+    return {}, false
+}
+latest_version :: proc(pkg: RepoPackage) -> string {
+    if len(pkg.versions) == 0 {
+        return ""
+    }
+    latest := pkg.versions[0].version
+    for v in pkg.versions[1:] {
+        if compare_versions(v.version, latest) > 0 {
+            latest = v.version
+        }
+    }
+    return latest
+}
 compare_versions :: proc(a: string, b: string) -> int {
     parts_a := strings.split_multi(a, {".", "-"})
     defer delete(parts_a, context.temp_allocator)
@@ -0,0 +1,109 @@
+package hpm
+
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:sort"
+import "core:crypto/sha2"
+import "core:encoding/json"
+
+// Wyniki solvera dla `install`, zapamiętane na dysku. Klucz to skrót z
+// (sha256 indeksu z odciskiem hosta, znormalizowane żądanie, skrót zbioru zainstalowanych wersji).
+// Plik jest jeden na żądanie (skrót bez zbioru zainstalowanych) i trzyma tylko
+// ostatni plan, więc katalog nie rośnie z każdą zmianą zbioru zainstalowanych.
+// Cały katalog jest czyszczony, gdy refresh przyniesie nowy indeks.
+RESOLVE_CACHE_PATH := "/var/cache/hpm/resolve/"
+
+ResolvedPlan :: struct {
+    key:   string,
+    items: [dynamic]PkgVer,
+}
+
+ResolveCacheKey :: struct {
+    request: string, // nazwa pliku
+    full:    string, // zapisany w pliku; inny = plan nieaktualny
+}
+
+sha256_hex :: proc(data: []u8) -> string {
+    ctx: sha2.Context_256
+    sha2.init_256(&ctx)
+    sha2.update(&ctx, data)
+    hash: [sha2.DIGEST_SIZE_256]u8
+    sha2.final(&ctx, hash[:])
+    return hex_digest(hash[:])
+}
+
+// Pusty klucz oznacza brak klucza (np. brak repo.json) — wtedy cache jest pomijany
+resolve_cache_key :: proc(allocator: mem.Allocator, specs: []string, installed: ^map[string]string) -> ResolveCacheKey {
+    index_sha := load_index_meta(allocator).sha256
+    if index_sha == "" {
+        sha, err := compute_sha256_stream(allocator, REPO_JSON_PATH)
+        if err != .None {
+            return {}
+        }
+        index_sha = sha
+    }
+    // Ten sam indeks na innym jądrze czy libc to inny zbiór dostępnych wersji
+    index_sha = host_fingerprint(index_sha, host_facts())
+    request := make([dynamic]string, context.temp_allocator)
+    for spec in specs {
+        if s := strings.trim_space(spec); s != "" {
+            append(&request, s)
+        }
+    }
+    sort.quick_sort(request[:])
+    lines := make([dynamic]string, context.temp_allocator)
+    for pkg, ver in installed^ {
+        append(&lines, fmt.tprintf("%s@%s", pkg, ver))
+    }
+    sort.quick_sort(lines[:])
+    installed_hash := sha256_hex(transmute([]u8)strings.join(lines[:], "\n", context.temp_allocator))
+    request_key := fmt.tprintf("%s\n%s", index_sha, strings.join(request[:], " ", context.temp_allocator))
+    return ResolveCacheKey{
+        request = sha256_hex(transmute([]u8)request_key),
+        full    = sha256_hex(transmute([]u8)fmt.tprintf("%s\n%s", request_key, installed_hash)),
+    }
+}
+
+load_resolved :: proc(allocator: mem.Allocator, key: ResolveCacheKey) -> ([dynamic]PkgVer, bool) {
+    if key.full == "" {
+        return nil, false
+    }
+    data, ok := os.read_entire_file(fmt.tprintf("%s%s.json", RESOLVE_CACHE_PATH, key.request), allocator)
+    if !ok {
+        return nil, false
+    }
+    defer delete(data)
+    plan: ResolvedPlan
+    if json.unmarshal(data, &plan, allocator = allocator) != nil || plan.key != key.full {
+        delete(plan.items)
+        return nil, false
+    }
+    return plan.items, true
+}
+
+save_resolved :: proc(allocator: mem.Allocator, key: ResolveCacheKey, items: []PkgVer) {
+    if key.full == "" || !makedirs(RESOLVE_CACHE_PATH) {
+        return
+    }
+    plan := ResolvedPlan{key = key.full, items = make([dynamic]PkgVer, 0, len(items), allocator)}
+    defer delete(plan.items)
+    append(&plan.items, ..items)
+    data, merr := json.marshal(plan, allocator = allocator)
+    if merr != nil {
+        return
+    }
+    defer delete(data)
+    path := fmt.tprintf("%s%s.json", RESOLVE_CACHE_PATH, key.request)
+    tmp := fmt.tprintf("%s.tmp", path)
+    if os.write_entire_file(tmp, data) {
+        os.rename(tmp, path)
+    }
+}
+
+clear_resolve_cache :: proc() {
+    if os.exists(RESOLVE_CACHE_PATH) {
+        remove_tree(RESOLVE_CACHE_PATH)
+    }
+}
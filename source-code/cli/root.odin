@@ -0,0 +1,110 @@
+package hpm
+
+import "core:fmt"
+import "core:os"
+import "core:strings"
+
+// --root <dir>: hpm zarządza drzewem zamontowanym w <dir> (np. obraz systemu
+// budowany w chroocie). Wszystkie ścieżki store, stanu, blokady, indeksów,
+// generacji i /usr/bin są przenoszone pod <dir>, więc kilka obrazów można
+// budować naraz, każdy z własną blokadą. Wspólny zostaje tylko cache pobrań
+// (CACHE_PATH), chroniony blokadami flock z cache.odin.
+// Cele symlinków i treść wrapperów zostają bez prefiksu — wskazują ścieżki
+// widziane z wnętrza obrazu po jego uruchomieniu.
+install_root: string
+
+BIN_PATH := "/usr/bin/"
+
+rooted :: proc(path: string) -> string {
+    if install_root == "" {
+        return path
+    }
+    return fmt.aprintf("%s%s", install_root, path)
+}
+
+// Ścieżka widziana z wnętrza korzenia (dla celów symlinków)
+unrooted :: proc(path: string) -> string {
+    if install_root == "" {
+        return path
+    }
+    return strings.trim_prefix(path, install_root)
+}
+
+// Wycina --root z argumentów; musi się odbyć przed load_config.
+// Jak inne opcje globalne nie sięga za `run` ani za `--`.
+take_root_flag :: proc(args: []string) -> ([]string, string, bool) {
+    rest: [dynamic]string
+    root := ""
+    end := global_flags_end(args)
+    for i := 0; i < end; i += 1 {
+        if args[i] == "--root" {
+            if i + 1 >= len(args) {
+                return nil, "", false
+            }
+            root = args[i + 1]
+            i += 1
+            continue
+        }
+        if strings.has_prefix(args[i], "--root=") {
+            root = strings.trim_prefix(args[i], "--root=")
+            continue
+        }
+        append(&rest, args[i])
+    }
+    append(&rest, ..args[end:])
+    if root != "" && !strings.has_prefix(root, "/") {
+        return nil, "", false
+    }
+    return rest[:], strings.trim_right(root, "/"), true
+}
+
+relocate_paths :: proc(root: string) {
+    install_root = root
+    if root == "" {
+        return
+    }
+    STORE_PATH = rooted(STORE_PATH)
+    REPO_JSON_PATH = rooted(REPO_JSON_PATH)
+    REPO_JSON_TMP = rooted(REPO_JSON_TMP)
+    STATE_PATH = rooted(STATE_PATH)
+    STATE_TMP_PATH = rooted(STATE_TMP_PATH)
+    LOCK_PATH = rooted(LOCK_PATH)
+    LOG_PATH = rooted(LOG_PATH)
+    BIN_PATH = rooted(BIN_PATH)
+    TRASH_PATH = rooted(TRASH_PATH)
+    PROFILES_PATH = rooted(PROFILES_PATH)
+    PROFILE_LINK = rooted(PROFILE_LINK)
+    DEPGRAPH_PATH = rooted(DEPGRAPH_PATH)
+    DEPGRAPH_TMP = rooted(DEPGRAPH_TMP)
+    REPO_META_PATH = rooted(REPO_META_PATH)
+    REPO_ETAG_PATH = rooted(REPO_ETAG_PATH)
+    REPO_ZST_TMP = rooted(REPO_ZST_TMP)
+    REPO_SEQ_TMP = rooted(REPO_SEQ_TMP)
+    REPO_DELTA_TMP = rooted(REPO_DELTA_TMP)
+    HOST_INDEX_PATH = rooted(HOST_INDEX_PATH)
+    HOST_INDEX_TMP = rooted(HOST_INDEX_TMP)
+    SEARCH_INDEX_PATH = rooted(SEARCH_INDEX_PATH)
+    SEARCH_INDEX_TMP = rooted(SEARCH_INDEX_TMP)
+    QUERY_INDEX_PATH = rooted(QUERY_INDEX_PATH)
+    QUERY_INDEX_TMP = rooted(QUERY_INDEX_TMP)
+    CLOSURE_INDEX_PATH = rooted(CLOSURE_INDEX_PATH)
+    CLOSURE_INDEX_TMP = rooted(CLOSURE_INDEX_TMP)
+    RESOLVE_CACHE_PATH = rooted(RESOLVE_CACHE_PATH)
+    MIRROR_RANK_PATH = rooted(MIRROR_RANK_PATH)
+    MIRROR_RANK_TMP = rooted(MIRROR_RANK_TMP)
+    // Obraz bez własnej konfiguracji używa konfiguracji hosta budującego
+    if os.exists(rooted(CONFIG_PATH)) {
+        CONFIG_PATH = rooted(CONFIG_PATH)
+    }
+}
+
+// Polecenie backendu; pod --root backend też przenosi swoje ścieżki
+backend_command :: proc(args: ..string) -> []string {
+    cmd := make([dynamic]string, context.temp_allocator)
+    append(&cmd, BACKEND_PATH)
+    if install_root != "" {
+        append(&cmd, "--root", install_root)
+    }
+    append(&cmd, ..args)
+    return cmd[:]
+}
@@ -0,0 +1,401 @@
+package hpm
+
+import "base:runtime"
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:sort"
+
+// Indeks trigramowy do `hpm search`, budowany przy refresh.
+// Format (little endian, czytany jednym read i krojony bez parsowania):
+//   "HPMTRI01"                       magia
+//   u32 ndocs, ntri, npost, blob     liczności sekcji
+//   [64]u8                           sha256 repo.json, z którego zbudowano indeks
+//   ntri  x {u32 trigram, u32 off, u32 count}   posortowane po trigramie
+//   npost x u32                      listy dokumentów (rosnąco)
+//   ndocs x 8 x u32                  (off, len) nazwy, wersji, opisu i binarek w blobie
+//   blob                             teksty; binarki małymi literami, rozdzielone spacją
+SEARCH_INDEX_PATH := "/usr/lib/HackerOS/hpm/search.idx"
+SEARCH_INDEX_TMP  := "/usr/lib/HackerOS/hpm/search.idx.tmp"
+SEARCH_INDEX_MAGIC :: "HPMTRI01"
+SEARCH_HEADER_SIZE :: 8 + 4 * 4 + 64
+SEARCH_TOP_K :: 20
+
+SearchIndex :: struct {
+    data:     []u8,
+    ndocs:    int,
+    ntri:     int,
+    tri_off:  int,
+    post_off: int,
+    doc_off:  int,
+    blob_off: int,
+    sha256:   string,
+}
+
+SearchDoc :: struct {
+    name: string,
+    ver:  string,
+    desc: string,
+    bins: string,
+}
+
+SearchHit :: struct {
+    doc:   int,
+    score: int,
+}
+
+SearchSort :: struct {
+    idx:  ^SearchIndex,
+    hits: ^[dynamic]SearchHit,
+}
+
+put_u32le :: proc(buf: ^[dynamic]u8, v: u32) {
+    for i in 0..<4 {
+        append(buf, u8(v >> (8 * u32(i))))
+    }
+}
+
+get_u32le :: proc(buf: []u8) -> u32 {
+    return u32(buf[0]) | u32(buf[1]) << 8 | u32(buf[2]) << 16 | u32(buf[3]) << 24
+}
+
+// Wspólne dla indeksów w formacie HPMxxx01 (search.idx, query.idx). Plik idzie
+// na stertę, nie do areny procesu: rośnie z repo, a arena nie zwalnia.
+read_index_file :: proc(path: string, magic: string, header_size: int) -> ([]u8, bool) {
+    data, ok := os.read_entire_file(path, runtime.heap_allocator())
+    if !ok {
+        return nil, false
+    }
+    if len(data) < header_size || string(data[:len(magic)]) != magic {
+        delete(data, runtime.heap_allocator())
+        return nil, false
+    }
+    return data, true
+}
+
+free_index_file :: proc(data: []u8) {
+    delete(data, runtime.heap_allocator())
+}
+
+// Otwiera indeks, a gdy go brak albo zbudowano go z innego repo.json
+// (np. sprzed aktualizacji hpm) — przebudowuje i otwiera ponownie
+open_current_index :: proc($T: typeid, open: proc() -> (T, bool), close: proc(^T), build: proc(string) -> bool) -> (T, bool) {
+    meta := load_index_meta(context.allocator)
+    idx, ok := open()
+    if ok && (meta.sha256 == "" || idx.sha256 == meta.sha256) {
+        return idx, true
+    }
+    if ok {
+        close(&idx)
+    }
+    if !build(meta.sha256) {
+        return {}, false
+    }
+    return open()
+}
+
+// Przecięcie posortowanych list dokumentów, zaczynając od najkrótszej
+intersect_lists :: proc(lists: [][]u8) -> [dynamic]u32 {
+    result: [dynamic]u32
+    if len(lists) == 0 {
+        return result
+    }
+    shortest := 0
+    for list, i in lists {
+        if len(list) < len(lists[shortest]) {
+            shortest = i
+        }
+    }
+    for j := 0; j < len(lists[shortest]); j += 4 {
+        append(&result, get_u32le(lists[shortest][j:]))
+    }
+    for list, i in lists {
+        if i != shortest {
+            intersect_postings(&result, list, false)
+        }
+    }
+    return result
+}
+
+// Zostawia w result dokumenty obecne (albo, gdy exclude, nieobecne) na liście
+intersect_postings :: proc(result: ^[dynamic]u32, list: []u8, exclude: bool) {
+    kept := 0
+    pos := 0
+    for doc in result^ {
+        for pos < len(list) && get_u32le(list[pos:]) < doc {
+            pos += 4
+        }
+        present := pos < len(list) && get_u32le(list[pos:]) == doc
+        if present != exclude {
+            result^[kept] = doc
+            kept += 1
+        }
+    }
+    resize(result, kept)
+}
+
+trigram_key :: proc(s: string, i: int) -> u32 {
+    return u32(s[i]) << 16 | u32(s[i+1]) << 8 | u32(s[i+2])
+}
+
+// Buduje indeks z bieżącego repo.json. Używa sterty zamiast areny main,
+// bo listy dla dużych indeksów nie zmieszczą się w kilku megabajtach.
+build_search_index :: proc(repo_sha: string) -> bool {
+    arena: mem.Dynamic_Arena
+    mem.dynamic_arena_init(&arena, runtime.heap_allocator(), runtime.heap_allocator())
+    defer mem.dynamic_arena_destroy(&arena)
+    context.allocator = mem.dynamic_arena_allocator(&arena)
+
+    repo, repo_err := load_repo(context.allocator, true)
+    if repo_err != .None {
+        return false
+    }
+    names: [dynamic]string
+    for name in repo {
+        append(&names, name)
+    }
+    sort.quick_sort(names[:])
+
+    blob: [dynamic]u8
+    docs: [dynamic]u32
+    postings := make(map[u32][dynamic]u32)
+    add_text :: proc(blob: ^[dynamic]u8, docs: ^[dynamic]u32, s: string) {
+        append(docs, u32(len(blob)), u32(len(s)))
+        append(blob, s)
+    }
+    for name, doc in names {
+        pkg := repo[name]
+        latest := latest_version(pkg)
+        bins := strings.builder_make()
+        if ver_obj, ok := find_version(pkg, latest); ok {
+            for bin, i in ver_obj.bins {
+                if i > 0 {
+                    strings.write_byte(&bins, ' ')
+                }
+                strings.write_string(&bins, strings.to_lower(bin))
+            }
+        }
+        bins_text := strings.to_string(bins)
+        add_text(&blob, &docs, name)
+        add_text(&blob, &docs, latest)
+        add_text(&blob, &docs, pkg.description)
+        add_text(&blob, &docs, bins_text)
+
+        text := strings.to_lower(strings.join({name, pkg.description, bins_text}, " "))
+        for i in 0..<max(len(text) - 2, 0) {
+            key := trigram_key(text, i)
+            if key not_in postings {
+                postings[key] = make([dynamic]u32)
+            }
+            list := &postings[key]
+            // Dokumenty idą po kolei, więc duplikat może być tylko na końcu listy
+            if len(list^) == 0 || list^[len(list^) - 1] != u32(doc) {
+                append(list, u32(doc))
+            }
+        }
+    }
+    keys: [dynamic]u32
+    npost := 0
+    for key, list in postings {
+        append(&keys, key)
+        npost += len(list)
+    }
+    sort.quick_sort(keys[:])
+
+    out: [dynamic]u8
+    append(&out, SEARCH_INDEX_MAGIC)
+    put_u32le(&out, u32(len(names)))
+    put_u32le(&out, u32(len(keys)))
+    put_u32le(&out, u32(npost))
+    put_u32le(&out, u32(len(blob)))
+    sha_field: [64]u8
+    copy(sha_field[:], repo_sha)
+    append(&out, ..sha_field[:])
+    off: u32 = 0
+    for key in keys {
+        put_u32le(&out, key)
+        put_u32le(&out, off)
+        put_u32le(&out, u32(len(postings[key])))
+        off += u32(len(postings[key]))
+    }
+    for key in keys {
+        for doc in postings[key] {
+            put_u32le(&out, doc)
+        }
+    }
+    for v in docs {
+        put_u32le(&out, v)
+    }
+    append(&out, ..blob[:])
+    if !os.write_entire_file(SEARCH_INDEX_TMP, out[:]) {
+        return false
+    }
+    if os.rename(SEARCH_INDEX_TMP, SEARCH_INDEX_PATH) != os.ERROR_NONE {
+        os.remove(SEARCH_INDEX_TMP)
+        return false
+    }
+    log_to_file("INFO", fmt.tprintf("search index: %d packages, %d trigrams", len(names), len(keys)))
+    return true
+}
+
+open_search_index :: proc() -> (SearchIndex, bool) {
+    data, ok := read_index_file(SEARCH_INDEX_PATH, SEARCH_INDEX_MAGIC, SEARCH_HEADER_SIZE)
+    if !ok {
+        return {}, false
+    }
+    idx := SearchIndex{data = data}
+    idx.ndocs = int(get_u32le(data[8:]))
+    idx.ntri = int(get_u32le(data[12:]))
+    npost := int(get_u32le(data[16:]))
+    blob_len := int(get_u32le(data[20:]))
+    idx.sha256 = strings.trim_right_null(string(data[24:88]))
+    idx.tri_off = SEARCH_HEADER_SIZE
+    idx.post_off = idx.tri_off + 12 * idx.ntri
+    idx.doc_off = idx.post_off + 4 * npost
+    idx.blob_off = idx.doc_off + 32 * idx.ndocs
+    if idx.blob_off + blob_len != len(data) {
+        free_index_file(data)
+        return {}, false
+    }
+    return idx, true
+}
+
+close_search_index :: proc(idx: ^SearchIndex) {
+    free_index_file(idx.data)
+    idx^ = {}
+}
+
+search_doc :: proc(idx: ^SearchIndex, doc: int) -> SearchDoc {
+    field :: proc(idx: ^SearchIndex, doc: int, n: int) -> string {
+        p := idx.doc_off + 32 * doc + 8 * n
+        off := idx.blob_off + int(get_u32le(idx.data[p:]))
+        return string(idx.data[off:off + int(get_u32le(idx.data[p+4:]))])
+    }
+    return SearchDoc{field(idx, doc, 0), field(idx, doc, 1), field(idx, doc, 2), field(idx, doc, 3)}
+}
+
+// Lista dokumentów dla trigramu (wyszukiwanie binarne w tablicy trigramów)
+trigram_postings :: proc(idx: ^SearchIndex, key: u32) -> []u8 {
+    lo, hi := 0, idx.ntri
+    for lo < hi {
+        mid := (lo + hi) / 2
+        p := idx.tri_off + 12 * mid
+        k := get_u32le(idx.data[p:])
+        if k == key {
+            off := idx.post_off + 4 * int(get_u32le(idx.data[p+4:]))
+            return idx.data[off:off + 4 * int(get_u32le(idx.data[p+8:]))]
+        }
+        if k < key {
+            lo = mid + 1
+        } else {
+            hi = mid
+        }
+    }
+    return nil
+}
+
+// Kandydaci dla słowa: przecięcie list jego trigramów, od najkrótszej.
+// Słowa krótsze niż 3 znaki nie mają trigramów — wtedy kandydatami są wszyscy.
+term_candidates :: proc(idx: ^SearchIndex, term: string) -> [dynamic]u32 {
+    if len(term) < 3 {
+        result: [dynamic]u32
+        for doc in 0..<idx.ndocs {
+            append(&result, u32(doc))
+        }
+        return result
+    }
+    lists: [dynamic][]u8
+    defer delete(lists)
+    for i in 0..<len(term) - 2 {
+        list := trigram_postings(idx, trigram_key(term, i))
+        if list == nil {
+            return nil
+        }
+        append(&lists, list)
+    }
+    return intersect_lists(lists[:])
+}
+
+// Ranking: dokładna nazwa > prefiks nazwy > podciąg nazwy > binarka > opis
+score_term :: proc(doc: ^SearchDoc, name_lower: string, desc_lower: string, term: string) -> int {
+    switch {
+        case name_lower == term:
+            return 100
+        case strings.has_prefix(name_lower, term):
+            return 60
+        case strings.contains(name_lower, term):
+            return 40
+    }
+    for bin in strings.split(doc.bins, " ", context.temp_allocator) {
+        if bin == term {
+            return 30
+        }
+    }
+    if strings.contains(doc.bins, term) {
+        return 20
+    }
+    if strings.contains(desc_lower, term) {
+        return 10
+    }
+    return 0
+}
+
+search_index_query :: proc(idx: ^SearchIndex, query: string) -> [dynamic]SearchHit {
+    hits: [dynamic]SearchHit
+    terms := strings.fields(strings.to_lower(query, context.temp_allocator), context.temp_allocator)
+    if len(terms) == 0 {
+        return hits
+    }
+    // Kandydaci z najdłuższego słowa (najbardziej selektywne), reszta tylko weryfikuje
+    longest := 0
+    for term, i in terms {
+        if len(term) > len(terms[longest]) {
+            longest = i
+        }
+    }
+    candidates := term_candidates(idx, terms[longest])
+    defer delete(candidates)
+    for doc_id in candidates {
+        doc := search_doc(idx, int(doc_id))
+        name_lower := strings.to_lower(doc.name, context.temp_allocator)
+        desc_lower := strings.to_lower(doc.desc, context.temp_allocator)
+        total := 0
+        for term in terms {
+            s := score_term(&doc, name_lower, desc_lower, term)
+            if s == 0 {
+                total = 0
+                break
+            }
+            total += s
+        }
+        if total > 0 {
+            append(&hits, SearchHit{int(doc_id), total})
+        }
+    }
+    ctx := SearchSort{idx, &hits}
+    sort.sort(sort.Interface{
+        collection = &ctx,
+        len = proc(it: sort.Interface) -> int {
+            c := (^SearchSort)(it.collection)
+            return len(c.hits^)
+        },
+              less = proc(it: sort.Interface, i, j: int) -> bool {
+                  c := (^SearchSort)(it.collection)
+                  a, b := c.hits^[i], c.hits^[j]
+                  if a.score != b.score {
+                      return a.score > b.score
+                  }
+                  na, nb := search_doc(c.idx, a.doc).name, search_doc(c.idx, b.doc).name
+                  if len(na) != len(nb) {
+                      return len(na) < len(nb)
+                  }
+                  return na < nb
+              },
+              swap = proc(it: sort.Interface, i, j: int) {
+                  c := (^SearchSort)(it.collection)
+                  c.hits^[i], c.hits^[j] = c.hits^[j], c.hits^[i]
+              },
+    })
+    return hits
+}
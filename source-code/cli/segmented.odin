@@ -0,0 +1,182 @@
+package hpm
+
+import "base:intrinsics"
+import "base:runtime"
+import "core:fmt"
+import "core:os"
+import "core:mem"
+import "core:strings"
+import "core:strconv"
+import "core:thread"
+import "core:time"
+import "core:crypto/sha2"
+import "core:sys/linux"
+
+// Pobieranie dużych archiwów kilkoma połączeniami naraz. Pojedynczy strumień
+// do CDN z wysokim RTT rzadko wysyca łącze, a zakresy (Range) już tak.
+// Plik od razu dostaje docelowy rozmiar, każdy segment pisze w swój zakres (pwrite),
+// a wątek główny liczy sha256 po kolei, gdy tylko kolejny segment jest gotowy.
+MAX_SEGMENTS :: 16
+
+SegmentJob :: struct {
+    url:     string,
+    fd:      os.Handle,
+    start:   i64,
+    length:  i64,
+    ok:      bool,
+    done:    bool, // atomowo; ustawiane po zakończeniu curl
+}
+
+// Rozmiar i obsługa Range według nagłówków odpowiedzi na HEAD (po przekierowaniach)
+probe_range_support :: proc(url: string) -> (size: i64, ranges: bool) {
+    args := []string{"curl", "-sS", "-I", "-L", "--fail", "--connect-timeout", "5", url}
+    out, code, err := run_command_output(args, context.temp_allocator)
+    if code != 0 || err != .None {
+        return 0, false
+    }
+    for line in strings.split_lines(out, context.temp_allocator) {
+        l := strings.to_lower(strings.trim_space(line), context.temp_allocator)
+        // Każda odpowiedź w łańcuchu przekierowań zaczyna nagłówki od nowa
+        if strings.has_prefix(l, "http/") {
+            size, ranges = 0, false
+        } else if strings.has_prefix(l, "content-length:") {
+            if n, ok := strconv.parse_i64(strings.trim_space(l[len("content-length:"):])); ok {
+                size = n
+            }
+        } else if strings.has_prefix(l, "accept-ranges:") {
+            ranges = strings.contains(l, "bytes")
+        }
+    }
+    return
+}
+
+segment_worker :: proc(t: ^thread.Thread) {
+    job := (^SegmentJob)(t.data)
+    args := []string{
+        "curl", "-sS", "-L", "--fail", "--connect-timeout", "5",
+        "--speed-limit", "1024", "--speed-time", "15",
+        "-r", fmt.tprintf("%d-%d", job.start, job.start + job.length - 1), job.url,
+    }
+    written, code, err := run_command_to_file(args, job.fd, job.start)
+    // Serwer, który zignoruje Range, odeśle cały plik — to też porażka segmentu
+    job.ok = code == 0 && err == .None && written == job.length
+    intrinsics.atomic_store(&job.done, true)
+}
+
+// Zwraca sha256 pobranego pliku; ok == false oznacza, że wołający ma pobrać
+// plik zwykłym pojedynczym strumieniem (za mały, brak Range, błąd segmentu).
+// HEAD wysyłamy tylko, gdy rozmiar z indeksu przekracza próg — małe pliki
+// i pliki bez rozmiaru (indeks, delty) nie płacą za dodatkowe zapytanie.
+try_segmented_download :: proc(allocator: mem.Allocator, url: string, dest: string, expected_size: i64, quiet: bool) -> (string, bool) {
+    // Przy limicie pasma (prefetch) kilka połączeń niczego nie przyspieszy
+    if config.segment_threshold <= 0 || config.segments < 2 || download_rate_limit != "" {
+        return "", false
+    }
+    if expected_size < config.segment_threshold {
+        return "", false
+    }
+    // Poprzednie lustro zostawiło część pliku — wznowienie (-C -) jest tańsze
+    if st, err := os.stat(dest, context.temp_allocator); err == os.ERROR_NONE && st.size > 0 {
+        return "", false
+    }
+    size, ranges := probe_range_support(url)
+    if !ranges || size < config.segment_threshold {
+        return "", false
+    }
+    n := min(config.segments, MAX_SEGMENTS)
+    // Zadania, wątki i bufor skrótu ze sterty, nie z areny wołającego:
+    // fetch_archive dostaje arenę main, która nie zwalnia
+    heap := runtime.heap_allocator()
+    jobs, jobs_err := make([]SegmentJob, n, heap)
+    if jobs_err != nil || len(jobs) != n {
+        return "", false
+    }
+    defer delete(jobs, heap)
+    threads, threads_err := make([dynamic]^thread.Thread, 0, n, heap)
+    if threads_err != nil {
+        return "", false
+    }
+    defer delete(threads)
+    buf, buf_err := make([]u8, 1024 * 1024, heap)
+    if buf_err != nil || len(buf) == 0 {
+        return "", false
+    }
+    defer delete(buf, heap)
+    fd, err := os.open(dest, os.O_RDWR | os.O_CREATE | os.O_TRUNC, 0o644)
+    if err != os.ERROR_NONE {
+        return "", false
+    }
+    defer os.close(fd)
+    if linux.ftruncate(linux.Fd(fd), size) != .NONE {
+        os.remove(dest)
+        return "", false
+    }
+    if !quiet {
+        fmt.printf("%s➤ %s in %d segments%s\n", COLOR_YELLOW, format_bytes(size), n, COLOR_RESET)
+    }
+    start_time := time.now()
+    chunk := (size + i64(n) - 1) / i64(n)
+    for i in 0..<n {
+        start := i64(i) * chunk
+        jobs[i] = SegmentJob{url = url, fd = fd, start = start, length = min(chunk, size - start)}
+        if jobs[i].length <= 0 {
+            jobs[i].ok = true
+            jobs[i].done = true
+            continue
+        }
+        t := thread.create(segment_worker)
+        if t == nil {
+            jobs[i].done = true
+            continue
+        }
+        t.data = &jobs[i]
+        thread.start(t)
+        append(&threads, t)
+    }
+
+    // Skrót po kolei: segment k jest haszowany, gdy tylko się skończy,
+    // równolegle z pobieraniem kolejnych
+    ctx: sha2.Context_256
+    sha2.init_256(&ctx)
+    ok := true
+    for &job in jobs {
+        for !intrinsics.atomic_load(&job.done) {
+            time.sleep(10 * time.Millisecond)
+        }
+        if !job.ok {
+            ok = false
+            break
+        }
+        pos := job.start
+        end := job.start + job.length
+        for pos < end {
+            got, rerr := os.read_at(fd, buf[:int(min(i64(len(buf)), end - pos))], pos)
+            if rerr != os.ERROR_NONE || got <= 0 {
+                ok = false
+                break
+            }
+            sha2.update(&ctx, buf[:got])
+            pos += i64(got)
+        }
+        if !ok {
+            break
+        }
+    }
+    for t in threads {
+        thread.join(t)
+        thread.destroy(t)
+    }
+    if !ok {
+        log_to_file("WARN", fmt.tprintf("segmented download of %s failed, falling back to a single stream", url))
+        os.remove(dest)
+        return "", false
+    }
+    hash: [sha2.DIGEST_SIZE_256]u8
+    sha2.final(&ctx, hash[:])
+    elapsed := time.duration_seconds(time.since(start_time))
+    log_to_file("INFO", fmt.tprintf("segmented download: %s, %d bytes, %d segments, %.1f MiB/s", url, size, n, elapsed > 0 ? f64(size) / elapsed / (1024 * 1024) : 0))
+    if !quiet {
+        fmt.printf("%s✔ Download complete.%s\n", COLOR_GREEN, COLOR_RESET)
+    }
+    return strings.clone(hex_digest(hash[:]), allocator), true
+}
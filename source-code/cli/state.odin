@@ -8,6 +8,7 @@ import "core:time"
 import "core:path/filepath"
 VersionInfo :: struct {
     checksum: string,
+    digest_algo: string, // algorytm checksum; brak w starych wpisach = sha256
     date: time.Time,
     pinned: bool,
 }
@@ -33,9 +34,13 @@ save_state :: proc(packages: ^StatePackages, allocator: mem.Allocator) -> Error
     }
     defer delete(data)
     os.write_entire_file(STATE_TMP_PATH, data)
+    if durability != .None {
+        fsync_path(STATE_TMP_PATH)
+    }
     if os.rename(STATE_TMP_PATH, STATE_PATH) != os.ERROR_NONE {
         return .StateLoadFailed
     }
+    durable_rename_done(filepath.dir(STATE_PATH, context.temp_allocator))
     return .None
 }
 delete_state :: proc(state: ^StatePackages, allocator: mem.Allocator) {
@@ -43,6 +48,7 @@ delete_state :: proc(state: ^StatePackages, allocator: mem.Allocator) {
         for vkey, vinfo in val {
             delete(vkey, allocator)
             delete(vinfo.checksum, allocator)
+            delete(vinfo.digest_algo, allocator)
         }
         delete(val)
         delete(key, allocator)
@@ -54,7 +60,7 @@ get_installed :: proc(allocator: mem.Allocator, packages: ^StatePackages) -> (ma
     for pkg in packages^ {
         current_link := fmt.tprintf("%s%s/current", STORE_PATH, pkg)
         defer delete(current_link)
-        stat, err_stat := os.stat(current_link)
+        stat, err_stat := os.lstat(current_link)
         if err_stat != os.ERROR_NONE || !os.S_ISLNK(u32(stat.mode)) {
             continue
         }
@@ -5,35 +5,23 @@ import "core:os"
 import "core:mem"
 import "core:strings"
 import "core:path/filepath"
-import "core:sort"
 
-update :: proc(allocator: mem.Allocator) -> Error {
-    lock_err := acquire_lock()
-    if lock_err != .None {
-        return lock_err
-    }
-    defer release_lock()
-    log_to_file("INFO", "Updating installed packages")
-    repo, repo_err := load_repo(allocator)
-    if repo_err != .None {
-        return repo_err
-    }
-    defer deinit_repo(&repo, allocator)
-    state, state_err := load_state(allocator)
-    if state_err != .None {
-        return state_err
-    }
-    defer delete_state(&state, allocator)
-    err_save := save_state(&state, allocator)
-    if err_save != .None {
-        return err_save
-    }
-    updated_count := 0
+UpdateStep :: struct {
+    pkg:      string,
+    from:     string,
+    to:       string,
+    url:      string,
+    sha256:   string,
+    size:     i64,
+}
+
+// Wylicza pełny plan aktualizacji bez dotykania systemu plików
+plan_updates :: proc(allocator: mem.Allocator, repo: ^Repo, state: ^StatePackages) -> ([dynamic]UpdateStep, int) {
+    plan := make([dynamic]UpdateStep, allocator)
     current_count := 0
-    for pkg_name in state {
+    for pkg_name in state^ {
         current_link := fmt.tprintf("%s%s/current", STORE_PATH, pkg_name)
-        defer delete(current_link, allocator)
-        stat, err_stat := os.stat(current_link)
+        stat, err_stat := os.lstat(current_link)
         if err_stat != os.ERROR_NONE || !os.S_ISLNK(u32(stat.mode)) {
             continue
         }
@@ -42,55 +30,128 @@ update :: proc(allocator: mem.Allocator) -> Error {
             continue
         }
         current_ver := filepath.base(target)
-        delete(target, allocator)
-        if state[pkg_name][current_ver].pinned {
+        if state^[pkg_name][current_ver].pinned {
             current_count += 1
             continue
         }
-        pkg, okk := repo[pkg_name]
+        pkg, okk := repo^[pkg_name]
         if !okk {
             continue
         }
-        sorted_versions: [dynamic]string
-        defer delete(sorted_versions)
-        for v in pkg.versions {
-            append(&sorted_versions, strings.clone(v.version, allocator))
-        }
-        sort.sort(sort.Interface{
-            collection = &sorted_versions,
-            len = proc(it: sort.Interface) -> int { return len((^[dynamic]string)(it.collection)^) },
-                  less = proc(it: sort.Interface, i, j: int) -> bool {
-                      arr := (^[dynamic]string)(it.collection)^
-                      return compare_versions(arr[i], arr[j]) > 0
-                  },
-                  swap = proc(it: sort.Interface, i, j: int) {
-                      arr := (^[dynamic]string)(it.collection)^
-                      arr[i], arr[j] = arr[j], arr[i]
-                  },
-        })
-        if len(sorted_versions) == 0 {
+        latest_ver := latest_version(pkg)
+        if latest_ver == "" {
             continue
         }
-        latest_ver := sorted_versions[0]
         if compare_versions(latest_ver, current_ver) > 0 {
-            fmt.printf("%s➤ Updating %s%s%s from %s%s%s to %s%s%s%s\n", COLOR_YELLOW, COLOR_CYAN, pkg_name, COLOR_RESET, COLOR_CYAN, current_ver, COLOR_RESET, COLOR_CYAN, latest_ver, COLOR_RESET, COLOR_RESET)
-            rem_err := remove(allocator, fmt.tprintf("%s@%s", pkg_name, current_ver), true)
-            if rem_err != .None {
-                return rem_err
-            }
-            inst_err := install_single(allocator, pkg_name, latest_ver, &repo, &state)
-            if inst_err != .None {
-                return inst_err
-            }
-            updated_count += 1
+            ver_obj, _ := find_version(pkg, latest_ver)
+            append(&plan, UpdateStep{
+                pkg    = pkg_name,
+                from   = strings.clone(current_ver, allocator),
+                to     = latest_ver,
+                url    = ver_obj.url,
+                sha256 = archive_digest(ver_obj),
+                size   = ver_obj.size,
+            })
         } else {
             current_count += 1
         }
     }
-    fmt.printf("%s✔ Updates complete. Updated: %d, Already current: %d%s\n", COLOR_GREEN, updated_count, current_count, COLOR_RESET)
-    err_save = save_state(&state, allocator)
+    return plan, current_count
+}
+
+// update działa w czterech fazach:
+//   1. plan     — wylicz wszystkie podbicia wersji,
+//   2. prefetch — pobierz i zweryfikuj archiwa równolegle,
+//   3. stage    — rozpakuj nowe wersje obok starych (stare dalej działają),
+//   4. commit   — bariera trwałości (syncfs), przełącz wszystkie symlinki current i aktywuj nową generację,
+//                 a potem zbierz wersje, do których nie sięga żadna z ostatnich generacji.
+// Błąd w fazach 1-3 zostawia zainstalowane wersje nietknięte.
+update :: proc(allocator: mem.Allocator) -> Error {
+    lock_err := acquire_lock()
+    if lock_err != .None {
+        return lock_err
+    }
+    defer release_lock()
+    log_to_file("INFO", "Updating installed packages")
+    repo, repo_err := load_repo(allocator)
+    if repo_err != .None {
+        return repo_err
+    }
+    defer deinit_repo(&repo, allocator)
+    state, state_err := load_state(allocator)
+    if state_err != .None {
+        return state_err
+    }
+    defer delete_state(&state, allocator)
+    graph := load_depgraph(allocator, &state)
+
+    plan, current_count := plan_updates(allocator, &repo, &state)
+    defer delete(plan)
+    if len(plan) == 0 {
+        fmt.printf("%s✔ Updates complete. Updated: 0, Already current: %d%s\n", COLOR_GREEN, current_count, COLOR_RESET)
+        return .None
+    }
+    for step in plan {
+        fmt.printf("%s➤ Updating %s%s%s from %s%s%s to %s%s%s%s\n", COLOR_YELLOW, COLOR_CYAN, step.pkg, COLOR_RESET, COLOR_CYAN, step.from, COLOR_RESET, COLOR_CYAN, step.to, COLOR_RESET, COLOR_RESET)
+    }
+
+    jobs := make([]FetchJob, len(plan), allocator)
+    defer delete(jobs)
+    for step, i in plan {
+        jobs[i] = FetchJob{pkg = step.pkg, version = step.to, url = step.url, sha256 = step.sha256, size = step.size}
+    }
+    fetch_err := prefetch_archives(jobs)
+    if fetch_err != .None {
+        log_to_file("ERROR", "Update aborted: prefetch failed, nothing was changed")
+        return fetch_err
+    }
+
+    for step in plan {
+        pkg_path := fmt.tprintf("%s%s/%s", STORE_PATH, step.pkg, step.to)
+        if os.exists(pkg_path) {
+            continue
+        }
+        checksum := step.sha256 != "" ? step.sha256 : "none"
+        stage_err := stage_version(allocator, step.pkg, step.to, checksum)
+        if stage_err != .None {
+            log_to_file("ERROR", fmt.tprintf("Update aborted: staging %s@%s failed, nothing was activated", step.pkg, step.to))
+            return stage_err
+        }
+    }
+
+    durable_barrier(STORE_PATH, STATE_PATH)
+    for step in plan {
+        activate_err := activate_version(allocator, step.pkg, step.to)
+        if activate_err != .None {
+            log_to_file("ERROR", fmt.tprintf("Activation of %s@%s failed", step.pkg, step.to))
+            save_state(&state, allocator)
+            return activate_err
+        }
+        checksum := step.sha256 != "" ? step.sha256 : "none"
+        record_version(allocator, &state, step.pkg, step.to, checksum)
+        depgraph_set(&graph, &repo, step.pkg, step.to)
+    }
+    err_save := save_state(&state, allocator)
     if err_save != .None {
         return err_save
     }
+    save_depgraph(&graph, allocator)
+    // Jedna nowa generacja przełącza wszystkie binarki naraz. Stare wersje
+    // zostają w store, dopóki wskazuje na nie któraś z ostatnich generacji.
+    gen_err := commit_generation(allocator, &state)
+    if gen_err != .None {
+        return gen_err
+    }
+    used_archives := make([]PkgVer, len(plan), allocator)
+    defer delete(used_archives)
+    for step, i in plan {
+        used_archives[i] = PkgVer{step.pkg, step.to}
+    }
+    cache_after_transaction(allocator, &state, used_archives)
+    // Sprzątanie wersji, do których nie sięga już żadna z ostatnich generacji
+    if collected := collect_unreferenced(allocator, &state); collected > 0 {
+        fmt.printf("%s✔ Removed %d old version(s); space is reclaimed in the background.%s\n", COLOR_GREEN, collected, COLOR_RESET)
+    }
+    fmt.printf("%s✔ Updates complete. Updated: %d, Already current: %d%s\n", COLOR_GREEN, len(plan), current_count, COLOR_RESET)
     return .None
 }
@@ -1,4 +1,6 @@
 package hpm
+import "base:intrinsics"
+import "base:runtime"
 import "core:fmt"
 import "core:os"
 import "core:strings"
@@ -10,35 +12,217 @@ import "core:thread"
 import "core:mem"
 import "core:path/filepath"
 import "core:io"
+import "core:encoding/json"
 
 WIFEXITED :: proc "contextless" (status: i32) -> bool { return ((status) & 0o177) == 0 }
 WEXITSTATUS :: proc "contextless" (status: i32) -> i32 { return ((status) >> 8) & 0x000000ff }
 
+// Szuka programu w PATH jak execvp; "" gdy go nie ma
+find_executable :: proc(name: string) -> string {
+    if strings.contains_rune(name, '/') {
+        return name
+    }
+    for p in strings.split(os.get_env("PATH", context.temp_allocator), ":", context.temp_allocator) {
+        candidate := filepath.join({p, name}, context.temp_allocator)
+        stat, err := os.stat(candidate, context.temp_allocator)
+        if err == os.ERROR_NONE && (stat.mode & os.S_IXUSR != 0) {
+            return candidate
+        }
+    }
+    return ""
+}
+
+// Wspólny start dziecka dla run_command*: fork, podpięcie stdin/stdout i execve.
+// -1 zostawia strumień odziedziczony. Potoki są tworzone z CLOEXEC, więc
+// w dziecku po exec zostają tylko podpięte końce.
+// found == false: programu nie ma w PATH (wołający zwraca 127 jak powłoka).
+spawn_child :: proc(args: []string, stdin_fd: linux.Fd = -1, stdout_fd: linux.Fd = -1) -> (pid: linux.Pid, found: bool, err: Error) {
+    exec_path := find_executable(args[0])
+    if exec_path == "" {
+        return 0, false, .None
+    }
+    args_c := make([]cstring, len(args) + 1, context.temp_allocator)
+    for arg, i in args {
+        args_c[i] = strings.clone_to_cstring(arg, context.temp_allocator)
+    }
+    exec_path_c := strings.clone_to_cstring(exec_path, context.temp_allocator)
+    child, ferr := linux.fork()
+    if ferr != .NONE {
+        return 0, true, .BackendFailed
+    }
+    if child == 0 {
+        // Child
+        if stdin_fd >= 0 {
+            linux.dup2(stdin_fd, 0)
+        }
+        if stdout_fd >= 0 {
+            linux.dup2(stdout_fd, 1)
+        }
+        linux.execve(exec_path_c, raw_data(args_c), nil)
+        linux.exit(1)
+    }
+    return child, true, .None
+}
+
+wait_child :: proc(pid: linux.Pid) -> (int, Error) {
+    status: u32
+    _, werr := linux.waitpid(pid, &status, {}, nil)
+    if werr != .NONE || !WIFEXITED(i32(status)) {
+        return 1, .BackendFailed
+    }
+    return int(WEXITSTATUS(i32(status))), .None
+}
+
 run_command :: proc(args: []string) -> (int, Error) {
     if len(args) == 0 {
         return 1, .InvalidArgs
     }
-    exec_path: string
-    if filepath.is_abs(args[0]) || strings.contains_rune(args[0], '/') {
-        exec_path = args[0]
-    } else {
-        path_env := os.get_env("PATH")
-        paths := strings.split(path_env, ":")
-        defer delete(paths)
-        for p in paths {
-            candidate := filepath.join({p, args[0]})
-            defer delete(candidate)
-            if os.exists(candidate) {
-                stat, err := os.stat(candidate)
-                if err == os.ERROR_NONE && (stat.mode & os.S_IXUSR != 0) {
-                    exec_path = candidate
-                    break
-                }
+    pid, found, err := spawn_child(args)
+    if !found {
+        return 127, .None // Command not found
+    }
+    if err != .None {
+        return 1, err
+    }
+    return wait_child(pid)
+}
+
+// Jak run_command, ale na stdin dziecka podaje zakres [offset, offset+length)
+// z pliku src, przepuszczając te same bajty przez sha (jeśli podano).
+run_command_stdin :: proc(args: []string, src: os.Handle, offset: i64, length: i64, sha: ^sha2.Context_256 = nil) -> (int, Error) {
+    if len(args) == 0 {
+        return 1, .InvalidArgs
+    }
+    // Bufor ze sterty: arena main nie zwalnia, a bundle rozpakowuje wiele pakietów
+    buf, alloc_err := make([]u8, 1024 * 1024, runtime.heap_allocator())
+    if alloc_err != nil || len(buf) == 0 {
+        return 1, .BackendFailed
+    }
+    defer delete(buf, runtime.heap_allocator())
+    fds: [2]linux.Fd
+    if linux.pipe2(&fds, {.CLOEXEC}) != .NONE {
+        return 1, .BackendFailed
+    }
+    pid, found, err := spawn_child(args, stdin_fd = fds[0])
+    linux.close(fds[0])
+    if !found || err != .None {
+        linux.close(fds[1])
+        return found ? 1 : 127, err
+    }
+    pos := offset
+    remaining := length
+    for remaining > 0 {
+        want := min(i64(len(buf)), remaining)
+        n, rerr := os.read_at(src, buf[:int(want)], pos)
+        if rerr != os.ERROR_NONE || n <= 0 {
+            break
+        }
+        if sha != nil {
+            sha2.update(sha, buf[:n])
+        }
+        written := 0
+        for written < n {
+            w, werr := linux.write(fds[1], buf[written:n])
+            if werr != .NONE || w <= 0 {
+                break
             }
+            written += w
         }
-        if exec_path == "" {
-            return 127, .None // Command not found
+        if written < n {
+            break
+        }
+        pos += i64(n)
+        remaining -= i64(n)
+    }
+    linux.close(fds[1])
+    code, werr := wait_child(pid)
+    if werr != .None || remaining > 0 {
+        return 1, .BackendFailed
+    }
+    return code, .None
+}
+
+// Jak run_command, ale zwraca to, co dziecko wypisało na stdout
+run_command_output :: proc(args: []string, allocator := context.allocator) -> (string, int, Error) {
+    if len(args) == 0 {
+        return "", 1, .InvalidArgs
+    }
+    fds: [2]linux.Fd
+    if linux.pipe2(&fds, {.CLOEXEC}) != .NONE {
+        return "", 1, .BackendFailed
+    }
+    pid, found, err := spawn_child(args, stdout_fd = fds[1])
+    linux.close(fds[1])
+    if !found || err != .None {
+        linux.close(fds[0])
+        return "", found ? 1 : 127, err
+    }
+    sb: strings.Builder
+    strings.builder_init(&sb, allocator)
+    buf: [4096]u8
+    for {
+        n, rerr := linux.read(fds[0], buf[:])
+        if rerr != .NONE || n <= 0 {
+            break
         }
+        strings.write_bytes(&sb, buf[:n])
+    }
+    linux.close(fds[0])
+    code, werr := wait_child(pid)
+    return strings.to_string(sb), code, werr
+}
+
+// Jak run_command, ale stdout dziecka trafia do dst od pozycji offset (pwrite),
+// więc kilka procesów może naraz wypełniać różne zakresy jednego pliku
+run_command_to_file :: proc(args: []string, dst: os.Handle, offset: i64) -> (i64, int, Error) {
+    if len(args) == 0 {
+        return 0, 1, .InvalidArgs
+    }
+    // Woła go kilka wątków segmentów naraz; bufor ze sterty, nie z areny wołającego
+    buf, alloc_err := make([]u8, 256 * 1024, runtime.heap_allocator())
+    if alloc_err != nil || len(buf) == 0 {
+        return 0, 1, .BackendFailed
+    }
+    defer delete(buf, runtime.heap_allocator())
+    fds: [2]linux.Fd
+    if linux.pipe2(&fds, {.CLOEXEC}) != .NONE {
+        return 0, 1, .BackendFailed
+    }
+    pid, found, err := spawn_child(args, stdout_fd = fds[1])
+    linux.close(fds[1])
+    if !found || err != .None {
+        linux.close(fds[0])
+        return 0, found ? 1 : 127, err
+    }
+    pos := offset
+    write_failed := false
+    for {
+        n, rerr := linux.read(fds[0], buf[:])
+        if rerr != .NONE || n <= 0 {
+            break
+        }
+        if !write_failed {
+            w, werr := os.write_at(dst, buf[:n], pos)
+            if werr != os.ERROR_NONE || w != n {
+                // Czytamy dalej do końca, żeby dziecko nie zawisło na pełnym potoku
+                write_failed = true
+            }
+            pos += i64(n)
+        }
+    }
+    linux.close(fds[0])
+    code, werr := wait_child(pid)
+    if werr != .None || write_failed {
+        return pos - offset, 1, .BackendFailed
+    }
+    return pos - offset, code, .None
+}
+
+// Uruchamia komendę w tle, odłączoną od terminala (podwójny fork + setsid),
+// żeby przeżyła zakończenie hpm. Nie czeka na jej wynik.
+spawn_detached :: proc(args: []string) -> bool {
+    if len(args) == 0 {
+        return false
     }
     args_c: [dynamic]cstring
     defer delete(args_c)
@@ -46,32 +230,37 @@ run_command :: proc(args: []string) -> (int, Error) {
         append(&args_c, strings.clone_to_cstring(arg, context.temp_allocator))
     }
     append(&args_c, nil)
-    exec_path_c := strings.clone_to_cstring(exec_path, context.temp_allocator)
+    exec_path_c := strings.clone_to_cstring(args[0], context.temp_allocator)
     pid, ferr := linux.fork()
     if ferr != .NONE {
-        return 1, .BackendFailed
+        return false
     }
     if pid == 0 {
-        // Child
-        linux.execve(exec_path_c, raw_data(args_c), nil)
-        linux.exit(1)
-    } else if pid > 0 {
-        // Parent
-        status: u32
-        _, werr := linux.waitpid(pid, &status, {}, nil)
-        if werr != .NONE {
-            return 1, .BackendFailed
-        }
-        if WIFEXITED(i32(status)) {
-            return int(WEXITSTATUS(i32(status))), .None
-        } else {
-            return 1, .BackendFailed
+        // Child: nowa sesja, drugi fork i natychmiastowe wyjście
+        linux.setsid()
+        if gpid, gerr := linux.fork(); gerr == .NONE && gpid == 0 {
+            if null_fd, nerr := linux.open("/dev/null", {.RDWR}); nerr == .NONE {
+                linux.dup2(null_fd, 0)
+                linux.dup2(null_fd, 1)
+                linux.dup2(null_fd, 2)
+                linux.close(null_fd)
+            }
+            linux.execve(exec_path_c, raw_data(args_c), nil)
         }
+        linux.exit(0)
     }
-    return 1, .BackendFailed
+    status: u32
+    linux.waitpid(pid, &status, {}, nil)
+    return true
 }
 
-download_file :: proc(allocator: mem.Allocator, url: string, path: string) -> Error {
+// Limit przepustowości dla curl (--limit-rate, np. "2M"); "" = bez limitu.
+// Ustawiany przez `hpm prefetch`, żeby pobieranie w tle nie zapychało łącza.
+download_rate_limit: string
+
+// Gdy podano digest i plik przyszedł segmentami, dostaje sha256 policzone w trakcie.
+// Segmentami idą tylko pliki o znanym rozmiarze (size) od progu z konfiguracji.
+download_file :: proc(allocator: mem.Allocator, url: string, path: string, quiet: bool = false, digest: ^string = nil, size: i64 = 0) -> Error {
     if url == "" {
         log_to_file("ERROR", "download_file: blank URL provided")
         fmt.printf("%s✖ Download error: URL is empty.%s\n", COLOR_RED, COLOR_RESET)
@@ -82,29 +271,121 @@ download_file :: proc(allocator: mem.Allocator, url: string, path: string) -> Er
         fmt.printf("%s✖ Download error: destination path is empty.%s\n", COLOR_RED, COLOR_RESET)
         return .DownloadFailed
     }
-    fmt.printf("%s↓ Downloading %s...%s\n", COLOR_YELLOW, url, COLOR_RESET)
-    args := []string{"curl", "-L", "--progress-bar", "-o", path, url}
-    code, err := run_command(args[:])
-    if code != 0 || err != .None {
-        log_to_file("ERROR", fmt.tprintf("download_file: curl failed (code=%d) for url=%s", code, url))
-        return .DownloadFailed
+    // W trybie quiet kilka pobrań może iść równolegle, więc bez paska postępu
+    progress := quiet ? "-sS" : "--progress-bar"
+    // Pobieramy do .part; kolejne lustro wznawia transfer od miejsca, w którym
+    // poprzednie się urwało (-C -), a zawieszony transfer przerywa --speed-limit
+    // Nazwa z pid: prefetch w tle i update mogą pobierać to samo archiwum naraz
+    part := fmt.tprintf("%s.part.%d", path, linux.getpid())
+    os.remove(part)
+    candidates := ranked_mirrors(url)
+    defer delete(candidates)
+    for c, i in candidates {
+        if !quiet {
+            fmt.printf("%s↓ Downloading %s...%s\n", COLOR_YELLOW, c.url, COLOR_RESET)
+        }
+        if sha, ok := try_segmented_download(allocator, c.url, part, size, quiet); ok {
+            if os.rename(part, path) != os.ERROR_NONE {
+                os.remove(part)
+                return .DownloadFailed
+            }
+            if digest != nil {
+                digest^ = sha
+            }
+            return .None
+        }
+        args: [dynamic]string
+        defer delete(args)
+        append(&args, "curl", "-L", "--fail", progress)
+        append(&args, "--connect-timeout", "5", "--speed-limit", "1024", "--speed-time", "15")
+        if download_rate_limit != "" {
+            append(&args, "--limit-rate", download_rate_limit)
+        }
+        append(&args, "-C", "-", "-o", part, c.url)
+        code, err := run_command(args[:])
+        if code == CURL_RANGE_ERROR && err == .None {
+            // Lustro nie obsługuje Range — zaczynamy u niego od zera
+            os.remove(part)
+            code, err = run_command(args[:])
+        }
+        if code == 0 && err == .None {
+            if os.rename(part, path) != os.ERROR_NONE {
+                os.remove(part)
+                return .DownloadFailed
+            }
+            if !quiet {
+                fmt.printf("%s✔ Download complete.%s\n", COLOR_GREEN, COLOR_RESET)
+            }
+            return .None
+        }
+        log_to_file("WARN", fmt.tprintf("download_file: curl failed (code=%d) for url=%s", code, c.url))
+        mark_mirror_failed(c.prefix)
+        if i + 1 < len(candidates) && !quiet {
+            fmt.printf("%s➤ Failing over to the next mirror...%s\n", COLOR_YELLOW, COLOR_RESET)
+        }
     }
-    fmt.printf("%s✔ Download complete.%s\n", COLOR_GREEN, COLOR_RESET)
-    return .None
+    os.remove(part)
+    log_to_file("ERROR", fmt.tprintf("download_file: all mirrors failed for url=%s", url))
+    return .DownloadFailed
 }
 
+// Archiwa od tego rozmiaru haszuje backend (sha2 z SHA-NI / ARMv8 SHA,
+// mmap + MADV_SEQUENTIAL); mniejsze nie są warte uruchamiania procesu
+HASH_OFFLOAD_THRESHOLD :: 4 * 1024 * 1024
+HASH_READ_BUFFER       :: 1024 * 1024
+POSIX_FADV_SEQUENTIAL  :: 2
+POSIX_FADV_DONTNEED    :: 4
+
 compute_sha256_stream :: proc(allocator: mem.Allocator, path: string) -> (string, Error) {
+    if st, err := os.stat(path, context.temp_allocator); err == os.ERROR_NONE && st.size >= HASH_OFFLOAD_THRESHOLD {
+        if sha, ok := backend_hash(allocator, path); ok {
+            return sha, .None
+        }
+    }
+    return compute_sha256_portable(allocator, path, HASH_READ_BUFFER)
+}
+
+backend_hash :: proc(allocator: mem.Allocator, path: string, algo: string = DIGEST_SHA256) -> (string, bool) {
+    out, code, err := run_command_output({BACKEND_PATH, "hash", path, algo}, context.temp_allocator)
+    if code != 0 || err != .None {
+        return "", false
+    }
+    result: struct {
+        success: bool,
+        digest:  string,
+    }
+    if json.unmarshal(transmute([]u8)out, &result, allocator = context.temp_allocator) != nil || !result.success || len(result.digest) != 64 {
+        return "", false
+    }
+    return strings.clone(result.digest, allocator), true
+}
+
+// Haszowanie w procesie: duże odczyty zamiast 4 KiB, a po wszystkim strony
+// pliku wypadają z page cache, żeby weryfikacja nie wypychała gorących danych
+compute_sha256_portable :: proc(allocator: mem.Allocator, path: string, buffer_size: int) -> (string, Error) {
     f, err := os.open(path, os.O_RDONLY, 0)
     if err != os.ERROR_NONE {
         return "", .ChecksumMismatch
     }
     defer os.close(f)
+    intrinsics.syscall(linux.SYS_fadvise64, uintptr(f), 0, 0, POSIX_FADV_SEQUENTIAL)
+    defer intrinsics.syscall(linux.SYS_fadvise64, uintptr(f), 0, 0, POSIX_FADV_DONTNEED)
     ctx: sha2.Context_256
     sha2.init_256(&ctx)
-    buf: [4096]u8
+    // Bufor ze sterty, nie z areny wołającego: arena main nie zwalnia, a hashujemy
+    // wiele archiwów w jednym przebiegu
+    buf, alloc_err := make([]u8, buffer_size, runtime.heap_allocator())
+    if alloc_err != nil || len(buf) == 0 {
+        return "", .ChecksumMismatch
+    }
+    defer delete(buf, runtime.heap_allocator())
     for {
-        n, rerr := os.read(f, buf[:])
-        if rerr != os.ERROR_NONE || n == 0 {
+        n, rerr := os.read(f, buf)
+        if rerr != os.ERROR_NONE {
+            log_to_file("ERROR", fmt.tprintf("read error while hashing %s", path))
+            return "", .ChecksumMismatch
+        }
+        if n == 0 {
             break
         }
         sha2.update(&ctx, buf[:n])
@@ -132,6 +413,34 @@ readlink :: proc(path: string, allocator: mem.Allocator) -> (string, bool) {
     return res, true
 }
 
+// Podmienia symlink przez rename() nowego linku, więc nikt nie widzi chwili bez linku
+atomic_symlink :: proc(target: string, link_path: string) -> bool {
+    tmp_link := fmt.tprintf("%s.tmp", link_path)
+    os.remove(tmp_link)
+    symlink_err := linux.symlink(
+        strings.clone_to_cstring(target, context.temp_allocator),
+        strings.clone_to_cstring(tmp_link, context.temp_allocator),
+    )
+    if symlink_err != .NONE {
+        return false
+    }
+    if os.rename(tmp_link, link_path) != os.ERROR_NONE {
+        os.remove(tmp_link)
+        return false
+    }
+    return true
+}
+
+// Usuwa katalog razem z zawartością (odpowiednik rm -rf)
+remove_tree :: proc(path: string) -> bool {
+    if !os.exists(path) {
+        return true
+    }
+    rm_args := []string{"rm", "-rf", path}
+    code, err := run_command(rm_args[:])
+    return code == 0 && err == .None
+}
+
 log_to_file :: proc(level: string, message: string) {
     timestamp := time.now()
     ts_str := fmt.tprintf("%v", timestamp)
@@ -162,10 +471,25 @@ acquire_lock :: proc() -> Error {
     }
     my_pid := int(linux.getpid())
     os.write_entire_file(LOCK_PATH, transmute([]u8)fmt.tprintf("%d", my_pid))
+    cache_use_begin()
     return .None
 }
 
+// Czy blokadę trzyma inny, wciąż żyjący proces (bez komunikatu o błędzie)
+lock_busy :: proc() -> bool {
+    data, ok := os.read_entire_file(LOCK_PATH, context.temp_allocator)
+    if !ok {
+        return false
+    }
+    pid, pok := strconv.parse_int(string(data))
+    if !pok || pid == int(linux.getpid()) {
+        return false
+    }
+    return linux.kill(linux.Pid(i32(pid)), linux.Signal(0)) == .NONE
+}
+
 release_lock :: proc() {
+    cache_use_end()
     os.remove(LOCK_PATH)
 }
 